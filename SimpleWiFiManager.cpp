@@ -7,12 +7,27 @@
  **************************************************************/
 
 #include "SimpleWiFiManager.h"
+#ifndef WM_NO_UPDATE
+#if defined(ESP8266) || defined(WM_HOST)
+#include <Updater.h>
+#elif defined(ESP32)
+#include <Update.h>
+#endif
+#endif
+
+#ifdef WM_WPS
+volatile int SimpleWiFiManager::_wpsResult = SimpleWiFiManager::WPS_PENDING;
+#endif
 
 SimpleWiFiManager::SimpleWiFiManager() {
 	int len = strlen_P(DEFAULT_APNAME) + 1;
 	char* apName = new char[len];
 	memcpy_P(&apName[0], DEFAULT_APNAME, len);
 	_apName = apName;
+
+	//start with a random generation, so ETags of a previous boot do not match
+	_configGeneration = hardwareRandom();
+	invalidatePageCache();
 }
 
 SimpleWiFiManager::~SimpleWiFiManager()
@@ -21,6 +36,12 @@ SimpleWiFiManager::~SimpleWiFiManager()
 	if (_apPassword != nullptr) {
 		delete[] _apPassword;
 	}
+#if defined(ESP32)
+	//the event handler must not outlive the manager
+	if (_staDisconnectedEvent != 0) {
+		WiFi.removeEvent(_staDisconnectedEvent);
+	}
+#endif
 }
 
 void SimpleWiFiManager::cacheAP(const char* const Name, const char* const Password) {
@@ -42,12 +63,10 @@ void SimpleWiFiManager::cacheAP(const char* const Name, const char* const Passwo
 	else {
 		_apPassword = nullptr;
 	}
+	invalidatePageCache();
 }
 
 void SimpleWiFiManager::setupConfigPortal() {
-	dnsServer.reset(new DNSServer());
-	server.reset(new ESP8266WebServer(80));
-
 	DEBUG_WM(F(""));
 
 	DEBUG_WM(F("Configuring access point... "));
@@ -67,28 +86,96 @@ void SimpleWiFiManager::setupConfigPortal() {
 		WiFi.softAPConfig(_ap_static_ip, _ap_static_gw, _ap_static_sn);
 	}
 
+	DEBUG_WM(F("AP channel / score: "));
+	DEBUG_WM(_apChannel);
+	DEBUG_WM(_apChannelScore);
+
+	startSoftAP();
+
+	delay(500); // Without delay I've seen the IP address blank
+	DEBUG_WM(F("AP IP address: "));
+	DEBUG_WM(WiFi.softAPIP());
+
+	_lastStationSeen = millis();
+#if defined(ESP8266) || defined(WM_HOST)
+	_stationJoined = false;
+	_apStationConnectedHandler = WiFi.onSoftAPModeStationConnected([this](const WiFiEventSoftAPModeStationConnected&) {
+		_stationJoined = true;
+	});
+#endif
+
+	startPortalServers();
+}
+
+void SimpleWiFiManager::startSoftAP() {
 	if (_apPassword != NULL) {
-		WiFi.softAP(_apName, _apPassword);//password option
+		WiFi.softAP(_apName, _apPassword, _apChannel);//password option
 	}
 	else {
-		WiFi.softAP(_apName);
+		WiFi.softAP(_apName, NULL, _apChannel);
+	}
+}
+
+/** Moves the AP to the channel of the router with the given SSID, if the last scan found it.
+	The SDK forces the AP onto the channel of the station, so doing it before the station connects
+	keeps the AP from switching channels under its clients in the middle of the trial. */
+void SimpleWiFiManager::followRouterChannel(const String& ssid) {
+	int n = WiFi.scanComplete();
+	int best = -1;
+	for (int i = 0; i < n; i++) {
+		if (WiFi.SSID(i) == ssid && (best == -1 || WiFi.RSSI(i) > WiFi.RSSI(best))) {
+			best = i;
+		}
+	}
+	if (best == -1 || WiFi.channel(best) == _apChannel) {
+		return;
 	}
+	_apChannel = WiFi.channel(best);
+	_apChannelScore = 0;
+	DEBUG_WM(F("Moving the AP to the channel of the router:"));
+	DEBUG_WM(_apChannel);
+	trace(TraceAPChannel, _apChannel, 0);
+	startSoftAP();
+	//the info page shows the channel
+	invalidatePageCache();
+}
 
-	delay(500); // Without delay I've seen the IP address blank
-	DEBUG_WM(F("AP IP address: "));
-	DEBUG_WM(WiFi.softAPIP());
+void SimpleWiFiManager::startPortalServers() {
+	dnsServer.reset(new DNSServer());
+	server.reset(new WiFiManagerWebServer(80));
+	trace(TracePortalServers, 1);
 
 	/* Setup the DNS server redirecting all the domains to the apIP */
 	dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
 	dnsServer->start(DNS_PORT, "*", WiFi.softAPIP());
 
+	//needed to answer revalidations of cached pages with 304
+	const char* headerKeys[] = { "If-None-Match" };
+	server->collectHeaders(headerKeys, 1);
+
 	/* Setup web pages: root, wifi config pages, SO captive portal detectors and not found. */
 	server->on(String(F("/")), std::bind(&SimpleWiFiManager::handleRoot, this));
 	server->on(String(F("/wifi")), std::bind(&SimpleWiFiManager::handleWifi, this, true));
+#ifndef WM_NO_NOSCAN_PAGE
 	server->on(String(F("/0wifi")), std::bind(&SimpleWiFiManager::handleWifi, this, false));
+#endif
 	server->on(String(F("/wifisave")), std::bind(&SimpleWiFiManager::handleWifiSave, this));
+#ifndef WM_NO_INFO_PAGE
 	server->on(String(F("/i")), std::bind(&SimpleWiFiManager::handleInfo, this));
+#endif
+#ifndef WM_NO_RESET_PAGE
 	server->on(String(F("/r")), std::bind(&SimpleWiFiManager::handleReset, this));
+#endif
+	server->on(String(F("/events")), std::bind(&SimpleWiFiManager::handleEvents, this));
+#ifdef WM_TRACE
+	server->on(String(F("/trace")), std::bind(&SimpleWiFiManager::handleTrace, this));
+#endif
+#ifndef WM_NO_UPDATE
+	if (_otaEnabled) {
+		server->on(String(F("/update")), HTTP_GET, std::bind(&SimpleWiFiManager::handleUpdate, this));
+		server->on(String(F("/update")), HTTP_POST, std::bind(&SimpleWiFiManager::handleUpdateDone, this), std::bind(&SimpleWiFiManager::handleUpdateUpload, this));
+	}
+#endif
 	//server->on("/generate_204", std::bind(&SimpleWiFiManager::handle204, this));  //Android/Chrome OS captive portal check.
 	server->on(String(F("/fwlink")), std::bind(&SimpleWiFiManager::handleRoot, this));  //Microsoft captive portal. Maybe not needed. Might be handled by notFound handler.
 	server->onNotFound(std::bind(&SimpleWiFiManager::handleNotFound, this));
@@ -98,7 +185,7 @@ void SimpleWiFiManager::setupConfigPortal() {
 }
 
 boolean SimpleWiFiManager::autoConnect() {
-	String ssid = "ESP" + String(ESP.getChipId());
+	String ssid = "ESP" + String(chipId());
 	return autoConnect(ssid.c_str(), NULL);
 }
 
@@ -106,6 +193,7 @@ boolean SimpleWiFiManager::autoConnect(char const *apName, char const *apPasswor
 	if (status != ManagerStatus::Idle) { return false; }
 	DEBUG_WM(F(""));
 	DEBUG_WM(F("AutoConnect"));
+	_timedOut = false;
 
 	// attempt to connect; should it fail, fall back to AP
 	WiFi.mode(WIFI_STA);
@@ -113,20 +201,34 @@ boolean SimpleWiFiManager::autoConnect(char const *apName, char const *apPasswor
 	cacheAP(apName, apPassword);
 
 	if (connectWifi("", "")) {
+		setStatus(ManagerStatus::ConnectingSaved);
 		return true;
 	}
 
-	initConfigPortal();
+	startFallback();
 	return true;
 }
 
+/** Starts WPS, if it is enabled, or the config portal */
+void SimpleWiFiManager::startFallback() {
+#ifdef WM_WPS
+	if (_tryWPS) {
+		startWPS();
+		setStatus(ManagerStatus::ConnectingWPS);
+		return;
+	}
+#endif
+	initConfigPortal();
+}
+
 boolean SimpleWiFiManager::startConfigPortal() {
-	String ssid = "ESP" + String(ESP.getChipId());
+	String ssid = "ESP" + String(chipId());
 	return startConfigPortal(ssid.c_str(), NULL);
 }
 
 boolean  SimpleWiFiManager::startConfigPortal(char const *apName, char const *apPassword) {
 	if (status != ManagerStatus::Idle) { return false; }
+	_timedOut = false;
 
 	//Save the given apName and apPassword for later usage
 	cacheAP(apName, apPassword);
@@ -141,23 +243,46 @@ void SimpleWiFiManager::initConfigPortal() {
 		WiFi.persistent(false);
 		// disconnect sta, start ap
 		WiFi.disconnect(); //  this alone is not enough to stop the autoconnecter
-		WiFi.mode(WIFI_AP);
 		WiFi.persistent(true);
+		//scan while the station is still enabled, HandleConnecting starts the AP once the scan is done
+		if (startAPChannelScan()) {
+			setStatus(ManagerStatus::StartingAP);
+			return;
+		}
+		startAccessPoint(false);
 	}
 	else {
+		//the AP has to stay on the channel of the station
+		_apChannel = WiFi.channel();
+		_apChannelScore = 0;
+		startAccessPoint(true);
+	}
+}
+
+/** Starts the AP of the config portal on the selected channel, next to the station if it is kept */
+void SimpleWiFiManager::startAccessPoint(boolean keepStation) {
+	if (keepStation) {
 		//setup AP
 		WiFi.mode(WIFI_AP_STA);
 		DEBUG_WM(F("SET AP STA"));
 	}
+	else {
+		WiFi.persistent(false);
+		WiFi.mode(WIFI_AP);
+		WiFi.persistent(true);
+	}
 
 	//notify we entered AP mode
 	if (_apcallback != NULL) {
 		_apcallback(this);
 	}
 
+	//the info page shows the channel
+	invalidatePageCache();
+
 	connect = false;
-	status = ManagerStatus::HandlingAP;
 	setupConfigPortal();
+	setStatus(ManagerStatus::HandlingAP);
 }
 
 boolean SimpleWiFiManager::HandleConnecting() {
@@ -171,22 +296,36 @@ boolean SimpleWiFiManager::HandleConnecting() {
 			return true;
 		}
 		else if (connectResult == WL_CONNECT_FAILED) {
-#ifdef NO_EXTRA_4K_HEAP
-			if (_tryWPS) {
-				startWPS();
-				status = ManagerStatus::ConnectingWPS;
-			}
-			else {
-				initConfigPortal();
-			}
-#else
-			initConfigPortal();
-#endif
+			startFallback();
 		}
 		break;
 	}
-#ifdef NO_EXTRA_4K_HEAP
+#ifdef WM_WPS
 	case SimpleWiFiManager::ConnectingWPS: {
+		if (!_wpsConnecting) {
+			//WPS is still running, the SDK reports the result by callback
+			int wpsResult = _wpsResult;
+			if (wpsResult == WPS_PENDING) {
+				if (millis() - _wpsStart > _wpsTimeout) {
+					DEBUG_WM(F("WPS timed out."));
+					stopWPS();
+					initConfigPortal();
+				}
+				break;
+			}
+			stopWPS();
+			if (wpsResult != WPS_CB_ST_SUCCESS) {
+				DEBUG_WM(F("WPS failed."));
+				initConfigPortal();
+				break;
+			}
+			DEBUG_WM(F("WPS succeeded, connecting."));
+			stationConnect();
+			_connectStart = millis();
+			_wpsConnecting = true;
+			break;
+		}
+
 		wl_status_t connectResult = handleWaitConnect();
 		if (connectResult == WL_CONNECTED) {
 			return true;
@@ -197,22 +336,33 @@ boolean SimpleWiFiManager::HandleConnecting() {
 		break;
 	}
 #endif
+	case SimpleWiFiManager::StartingAP:
+		if (selectAPChannel()) {
+			startAccessPoint(false);
+		}
+		break;
 	case SimpleWiFiManager::HandlingAP:
 		{
-			//DNS
-			dnsServer->processNextRequest();
-			//HTTP
-			server->handleClient();
+			if (reclaimPortal()) {
+				//the AP was shut down, nobody used it
+				return true;
+			}
+			handlePortal();
 
 			//connect gets set by the http-server
-			if (connect) {
+			//wait a moment, so the saved page can be delivered and subscribe to the events
+			if (connect && millis() - _connectRequestTime > 2000) {
 				connect = false;
-				delay(2000);
 				DEBUG_WM(F("Connecting to new AP"));
 
+				//try the credentials next to the running AP, they are only stored once they work
+				persistStationConfig(false);
+				followRouterChannel(_ssid);
+				WiFi.mode(WIFI_AP_STA);
+
 				// using user-provided  _ssid, _pass in place of system-stored ssid and pass
 				if (connectWifi(_ssid, _pass)) {
-					status = ManagerStatus::ConnectingAP;
+					setStatus(ManagerStatus::ConnectingAP);
 				}
 				else {
 					//this should not be possible
@@ -223,13 +373,17 @@ boolean SimpleWiFiManager::HandleConnecting() {
 		}
 		break;
 	case SimpleWiFiManager::ConnectingAP: {
+			//keep the portal and the status stream alive while connecting
+			handlePortal();
+
 		//Wait for connect to finish
 			wl_status_t connectResult = handleWaitConnect();
 			if (connectResult == WL_CONNECTED) {
 				return true;
 			}
 			else if (connectResult == WL_CONNECT_FAILED) {
-				status = ManagerStatus::HandlingAP;
+				endCredentialTrial(false);
+				setStatus(ManagerStatus::HandlingAP);
 			}
 		}
 		break;
@@ -241,42 +395,322 @@ boolean SimpleWiFiManager::HandleConnecting() {
 }
 
 void SimpleWiFiManager::FinishConnecting() {
+#ifdef WM_WPS
+	if (status == ManagerStatus::ConnectingWPS && !_wpsConnecting) {
+		stopWPS();
+	}
+#endif
 	if (status == ManagerStatus::ConnectingAP || status == ManagerStatus::HandlingAP) {
-		server.reset();
-		dnsServer.reset();
+		stopPortalServers();
 	}
+	setStatus(ManagerStatus::Idle);
+	_eventClient.stop();
+#if defined(ESP8266) || defined(WM_HOST)
+	_staConnectedHandler = nullptr;
+	_staDisconnectedHandler = nullptr;
+	_apStationConnectedHandler = nullptr;
+#elif defined(ESP32)
+	if (_staDisconnectedEvent != 0) {
+		WiFi.removeEvent(_staDisconnectedEvent);
+		_staDisconnectedEvent = 0;
+	}
+#endif
 	WiFi.softAPdisconnect(true);
-	status = ManagerStatus::Idle;
+}
+
+void SimpleWiFiManager::stopPortalServers() {
+	if (!server) { return; }
+	_eventClient.stop();
+	server.reset();
+	dnsServer.reset();
+	clearPageCache();
+	trace(TracePortalServers, 0);
+}
+
+/** Stops the portal servers, when no station was associated and the portal was not used for the idle timeout, and starts them again once a station joins.
+	Returns true, if the AP was shut down after the AP timeout. */
+boolean SimpleWiFiManager::reclaimPortal() {
+	if (_portalIdleTimeout == 0 && _apTimeout == 0) {
+		return false;
+	}
+
+	uint32_t now = millis();
+	boolean stationJoined = HasConnectedClients();
+#if defined(ESP8266) || defined(WM_HOST)
+	//catches stations that joined and left since the last call
+	stationJoined = stationJoined || _stationJoined;
+	_stationJoined = false;
+#endif
+	if (stationJoined) {
+		_lastStationSeen = now;
+		if (!server) {
+			DEBUG_WM(F("Station joined, starting portal servers"));
+			startPortalServers();
+		}
+		return false;
+	}
+
+	uint32_t idle = std::min(now - _lastStationSeen, MillisSinceLastPortalUsage());
+	if (_apTimeout != 0 && idle > _apTimeout) {
+		DEBUG_WM(F("AP unused, shutting it down"));
+		FinishConnecting();
+		_timedOut = true;
+		return true;
+	}
+	if (_portalIdleTimeout != 0 && server && idle > _portalIdleTimeout) {
+		DEBUG_WM(F("Portal unused, stopping portal servers"));
+		stopPortalServers();
+	}
+	return false;
+}
+
+void SimpleWiFiManager::handlePortal() {
+	if (!server) { return; }
+	//DNS
+	dnsServer->processNextRequest();
+	//HTTP
+	server->handleClient();
+}
+
+void SimpleWiFiManager::setStatus(ManagerStatus newStatus) {
+	if (status == newStatus) { return; }
+	status = newStatus;
+	trace(TraceStatus, newStatus);
+	sendEvent(F("status"), statusName(newStatus));
 }
 
 boolean SimpleWiFiManager::IsConnecting() {
 	return status != ManagerStatus::Idle;
 }
 
+void SimpleWiFiManager::setRoaming(boolean enabled, int rssiThreshold, uint8_t hysteresis) {
+	_roamingEnabled = enabled;
+	_roamThreshold = rssiThreshold;
+	_roamHysteresis = hysteresis;
+	_rssiCount = 0;
+	_rssiNext = 0;
+}
+
+void SimpleWiFiManager::HandleLinkQuality() {
+	if (!_roamingEnabled || status != ManagerStatus::Idle) {
+		return;
+	}
+	uint32_t now = millis();
+
+	if (_roaming) {
+		//wait for the station to get an address at the new BSSID
+		boolean done = WiFi.status() == WL_CONNECTED && memcmp(WiFi.BSSID(), _roamBSSID, sizeof(_roamBSSID)) == 0;
+		if (!done && now - _roamStart <= _connectTimeout) {
+			return;
+		}
+		_roaming = false;
+		_roamTime += now - _roamStart;
+		if (done) {
+			_roamCount++;
+			DEBUG_WM(F("Roamed to:"));
+			DEBUG_WM(WiFi.BSSIDstr());
+		}
+		else {
+			DEBUG_WM(F("Roaming timed out."));
+		}
+		//a pinned BSSID would keep the station from any other AP of the SSID,
+		//after a timeout it reconnects to any of them, else the link stays and only the next reconnect is free
+		unpinBSSID(!done);
+		trace(TraceRoam, done ? TraceRoamDone : TraceRoamFailed, WiFi.RSSI());
+		return;
+	}
+
+	if (WiFi.status() != WL_CONNECTED) {
+		//samples of a lost link say nothing about the next one
+		_rssiCount = 0;
+		_rssiNext = 0;
+		return;
+	}
+
+	if (_roamScanning) {
+		int n = WiFi.scanComplete();
+		if (n == WIFI_SCAN_RUNNING) {
+			return;
+		}
+		_roamScanning = false;
+		traceScan(n);
+		if (n > 0) {
+			roamToBestBSSID(n);
+		}
+		WiFi.scanDelete();
+		return;
+	}
+
+	if (now - _lastRSSISample < RSSI_SAMPLE_INTERVAL) {
+		return;
+	}
+	_lastRSSISample = now;
+
+	int rssi = WiFi.RSSI();
+	_rssiHistory[_rssiNext] = rssi;
+	_rssiNext = (_rssiNext + 1) % RSSI_HISTORY_SIZE;
+	if (_rssiCount < RSSI_HISTORY_SIZE) { _rssiCount++; }
+	if (rssi < _rssiMin) { _rssiMin = rssi; }
+	if (rssi > _rssiMax) { _rssiMax = rssi; }
+
+	//only scan, if the link stayed weak for the whole history
+	if (_rssiCount == RSSI_HISTORY_SIZE && getSmoothedRSSI() < _roamThreshold
+		&& (_lastRoamScan == 0 || now - _lastRoamScan > ROAM_SCAN_INTERVAL)) {
+		DEBUG_WM(F("Weak link, scanning for a better AP"));
+		_lastRoamScan = now;
+		_roamScanning = true;
+		_roamSSID = WiFi.SSID();
+		startSSIDScan(_roamSSID);
+	}
+}
+
+int SimpleWiFiManager::getSmoothedRSSI() {
+	if (_rssiCount == 0) {
+		return 0;
+	}
+	int sum = 0;
+	for (uint8_t i = 0; i < _rssiCount; i++) {
+		sum += _rssiHistory[i];
+	}
+	return sum / _rssiCount;
+}
+
+/** Roams to the strongest BSSID of the scanned SSID, if it beats the current link by the hysteresis */
+void SimpleWiFiManager::roamToBestBSSID(int networkCount) {
+	int best = -1;
+	for (int i = 0; i < networkCount; i++) {
+		if (WiFi.SSID(i) == _roamSSID && (best == -1 || WiFi.RSSI(i) > WiFi.RSSI(best))) {
+			best = i;
+		}
+	}
+	if (best == -1 || memcmp(WiFi.BSSID(best), WiFi.BSSID(), sizeof(_roamBSSID)) == 0
+		|| WiFi.RSSI(best) < getSmoothedRSSI() + _roamHysteresis) {
+		DEBUG_WM(F("No better AP found."));
+		return;
+	}
+
+	DEBUG_WM(F("Roaming to:"));
+	DEBUG_WM(WiFi.BSSIDstr(best));
+	memcpy(_roamBSSID, WiFi.BSSID(best), sizeof(_roamBSSID));
+	trace(TraceRoam, TraceRoamStart, WiFi.RSSI(best));
+
+	//the BSSID must not be stored, the device would stick to it after a reboot
+	persistStationConfig(false);
+	WiFi.begin(_roamSSID.c_str(), WiFi.psk().c_str(), WiFi.channel(best), _roamBSSID);
+	persistStationConfig(true);
+
+	_roaming = true;
+	_roamStart = millis();
+	_rssiCount = 0;
+	_rssiNext = 0;
+}
+
+/** Drops the BSSID the station was pinned to for roaming, so the SDK may pick any AP of the SSID again */
+void SimpleWiFiManager::unpinBSSID(boolean reconnect) {
+	persistStationConfig(false);
+	clearStationBSSID();
+	persistStationConfig(true);
+	if (reconnect) {
+		WiFi.reconnect();
+	}
+}
+
 wl_status_t	SimpleWiFiManager::handleWaitConnect() {
 	wl_status_t wifistatus = WiFi.status();
+#ifdef WM_TRACE
+	if (wifistatus != _traceWiFiStatus) {
+		_traceWiFiStatus = wifistatus;
+		trace(TraceWiFiStatus, wifistatus);
+	}
+#endif
 	if (wifistatus == WL_CONNECTED) {
 		DEBUG_WM(F("Connected."));
 		DEBUG_WM(F("IP Address:"));
 		DEBUG_WM(WiFi.localIP());
+		//tell the portal before the AP goes down
+		sendEvent(F("result"), String(F("Connected, IP ")) + WiFi.localIP().toString());
+		if (status == ManagerStatus::ConnectingAP) {
+			endCredentialTrial(true);
+		}
 		//connected
 		WiFi.mode(WIFI_STA);
 		FinishConnecting();
 		return WL_CONNECTED;
 	}
+	//remember the last reported reason, the SDK keeps retrying and may reset it
+	ConnectFailure failure = stationFailure();
+	if (failure != FailureNone) {
+		_connectFailure = failure;
+	}
 	if (wifistatus == WL_CONNECT_FAILED) {
-		DEBUG_WM(F("Connect failed."));
+		if (_connectFailure == FailureNone) {
+			_connectFailure = FailureOther;
+		}
+		reportConnectFailure();
 		return WL_CONNECT_FAILED;
 	}
 	if (millis() - _connectStart > _connectTimeout) {
-		DEBUG_WM(F("Connect timed out."));
+		if (stationAssociated()) {
+			//associated, but got no address
+			_connectFailure = FailureDHCPTimeout;
+		}
+		else if (_connectFailure == FailureNone) {
+			_connectFailure = FailureTimeout;
+		}
+		reportConnectFailure();
 		return WL_CONNECT_FAILED;
 	}
 	return WL_IDLE_STATUS;
 }
 
+/** Stores the tried credentials on success, drops them and goes back to AP-only mode on failure */
+void SimpleWiFiManager::endCredentialTrial(boolean success) {
+	if (success) {
+		DEBUG_WM(F("Storing new credentials"));
+		commitStationConfig();
+	}
+	else {
+		//stop the SDK from retrying, it hops channels and disturbs the AP
+		WiFi.disconnect();
+		WiFi.mode(WIFI_AP);
+	}
+	persistStationConfig(true);
+}
+
+/** Reports the failure of the connect-attempt, it is kept for clients that subscribe to the status stream later */
+void SimpleWiFiManager::reportConnectFailure() {
+	DEBUG_WM(connectFailureName(_connectFailure));
+	trace(TraceConnectFailure, _connectFailure);
+	_reportedFailure = _connectFailure;
+	sendEvent(F("result"), connectFailureName(_connectFailure));
+}
+
 bool SimpleWiFiManager::connectWifi(String ssid, String pass) {
 	DEBUG_WM(F("Connecting as wifi client..."));
+	_connectFailure = FailureNone;
+	_reportedFailure = FailureNone;
+#if defined(ESP8266) || defined(WM_HOST)
+	_staAssociated = false;
+	_staConnectedHandler = WiFi.onStationModeConnected([this](const WiFiEventStationModeConnected&) {
+		_staAssociated = true;
+	});
+	_staDisconnectedHandler = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected&) {
+		_staAssociated = false;
+	});
+#elif defined(ESP32)
+	_staDisconnectReason = 0;
+	if (_staDisconnectedEvent == 0) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 2
+		_staDisconnectedEvent = WiFi.onEvent([this](WiFiEvent_t, WiFiEventInfo_t info) {
+			_staDisconnectReason = info.wifi_sta_disconnected.reason;
+		}, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+#else
+		_staDisconnectedEvent = WiFi.onEvent([this](WiFiEvent_t, WiFiEventInfo_t info) {
+			_staDisconnectReason = info.disconnected.reason;
+		}, SYSTEM_EVENT_STA_DISCONNECTED);
+#endif
+	}
+#endif
 
 	// check if we've got static_ip settings, if we do, use those.
 	if (_sta_static_ip) {
@@ -288,31 +722,110 @@ bool SimpleWiFiManager::connectWifi(String ssid, String pass) {
 	if (ssid != "") {
 		WiFi.begin(ssid.c_str(), pass.c_str());
 		_connectStart = millis();
-		status = ManagerStatus::ConnectingSaved;
 		return true;
 	}
 	if (WiFi.SSID()) {
 		DEBUG_WM(F("Using last saved values, should be faster"));
-		//trying to fix connection in progress hanging
-		ETS_UART_INTR_DISABLE();
-		wifi_station_disconnect();
-		ETS_UART_INTR_ENABLE();
+		stationDisconnect();
 
 		WiFi.begin();
 		_connectStart = millis();
-		status = ManagerStatus::ConnectingSaved;
 		return true;
 	}
 	DEBUG_WM(F("No saved credentials"));
 	return false;
 }
 
+/** Starts the scan for the AP channel without waiting for it.
+	Returns false, if the channel is set and no scan is needed. */
+boolean SimpleWiFiManager::startAPChannelScan() {
+	_apChannelScore = 0;
+	if (_apChannelOverride != 0) {
+		_apChannel = _apChannelOverride;
+		return false;
+	}
+
+	//results still held may be old or limited to one SSID, only a new scan tells the current occupancy
+	WiFi.scanDelete();
+	WiFi.scanNetworks(true);
+	_apChannelScanStart = millis();
+	return true;
+}
+
+/** Selects the AP channel with the lowest occupancy, weighted by count and signal strength of the networks on and next to it.
+	Returns false, while the scan is still running. */
+boolean SimpleWiFiManager::selectAPChannel() {
+	int n = WiFi.scanComplete();
+	if (n == WIFI_SCAN_RUNNING) {
+		if (millis() - _apChannelScanStart < AP_CHANNEL_SCAN_TIMEOUT) {
+			return false;
+		}
+		DEBUG_WM(F("AP channel scan timed out."));
+	}
+	traceScan(n);
+
+	//only the channels of the configured country are candidates, e.g. 12 and 13 are illegal in North America
+	uint8_t firstChannel, channelCount;
+	if (!countryChannels(firstChannel, channelCount) || firstChannel < 1 || firstChannel > MAX_AP_CHANNEL || channelCount == 0) {
+		firstChannel = 1;
+		channelCount = DEFAULT_AP_CHANNELS;
+	}
+	uint8_t lastChannel = std::min<int>(firstChannel + channelCount - 1, MAX_AP_CHANNEL);
+
+	uint32_t scores[MAX_AP_CHANNEL] = {};
+	for (int i = 0; i < n; i++) {
+		int networkChannel = WiFi.channel(i);
+		//every network counts, strong ones more
+		uint32_t weight = 10 + getRSSIasQuality(WiFi.RSSI(i));
+		for (int channel = firstChannel; channel <= lastChannel; channel++) {
+			//20MHz channels overlap up to 4 channels apart
+			int distance = abs(channel - networkChannel);
+			if (distance < 5) {
+				scores[channel - 1] += weight * (5 - distance);
+			}
+		}
+	}
+	WiFi.scanDelete();
+
+	_apChannel = firstChannel;
+	for (uint8_t channel = firstChannel + 1; channel <= lastChannel; channel++) {
+		if (scores[channel - 1] < scores[_apChannel - 1]) {
+			_apChannel = channel;
+		}
+	}
+	_apChannelScore = scores[_apChannel - 1];
+	trace(TraceAPChannel, _apChannel, _apChannelScore > INT16_MAX ? INT16_MAX : _apChannelScore);
+	return true;
+}
+
+#ifdef WM_WPS
+/** Starts WPS push-button setup without waiting for it, HandleConnecting polls the result */
 void SimpleWiFiManager::startWPS() {
 	DEBUG_WM(F("START WPS"));
-	WiFi.beginWPSConfig();
-	DEBUG_WM(F("END WPS"));
+	_wpsResult = WPS_PENDING;
+	_wpsConnecting = false;
+	_wpsStart = millis();
+
+	WiFi.mode(WIFI_STA);
+	//the saved credentials have to survive, if WPS fails
+	persistStationConfig(false);
+	WiFi.disconnect();
+	persistStationConfig(true);
+	if (!wpsStart()) {
+		DEBUG_WM(F("WPS could not be started."));
+		_wpsResult = WPS_CB_ST_FAILED;
+	}
+}
+
+void SimpleWiFiManager::stopWPS() {
+	wpsStop();
 }
 
+void SimpleWiFiManager::wpsStatusCallback(int wpsStatus) {
+	_wpsResult = wpsStatus;
+}
+#endif
+
 void SimpleWiFiManager::resetSettings() {
 	DEBUG_WM(F("settings invalidated"));
 	DEBUG_WM(F("THIS MAY CAUSE AP NOT TO START UP PROPERLY. YOU NEED TO COMMENT IT OUT AFTER ERASING THE DATA."));
@@ -332,12 +845,14 @@ void SimpleWiFiManager::setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddres
 	_ap_static_ip = ip;
 	_ap_static_gw = gw;
 	_ap_static_sn = sn;
+	invalidatePageCache();
 }
 
 void SimpleWiFiManager::setSTAStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn) {
 	_sta_static_ip = ip;
 	_sta_static_gw = gw;
 	_sta_static_sn = sn;
+	invalidatePageCache();
 }
 
 void SimpleWiFiManager::setMinimumSignalQuality(int quality) {
@@ -346,11 +861,14 @@ void SimpleWiFiManager::setMinimumSignalQuality(int quality) {
 
 /** Handle root or redirect to captive portal */
 void SimpleWiFiManager::handleRoot() {
-	_lastPortalHandle = millis();
+	portalUsed(RouteRoot);
 	DEBUG_WM(F("Handle root"));
 	if (captivePortal()) { // If caprive portal redirect instead of displaying the page.
 		return;
 	}
+	if (sendCachedPage(PageRoot)) {
+		return;
+	}
 
 	String page = FPSTR(HTTP_HEADER);
 	page.replace("{v}", "Options");
@@ -363,16 +881,24 @@ void SimpleWiFiManager::handleRoot() {
 	page += String(F("</h1>"));
 	page += String(F("<h3>WiFiManager</h3>"));
 	page += FPSTR(HTTP_PORTAL_OPTIONS);
+#ifndef WM_NO_UPDATE
+	if (_otaEnabled) {
+		page += FPSTR(HTTP_PORTAL_UPDATE);
+	}
+#endif
 	page += FPSTR(HTTP_END);
 
-	server->sendHeader("Content-Length", String(page.length()));
-	server->send(200, "text/html", page);
-
+	sendAndCachePage(PageRoot, page);
 }
 
 /** Wifi config page handler */
 void SimpleWiFiManager::handleWifi(boolean scan) {
-	_lastPortalHandle = millis();
+	portalUsed(scan ? RouteWifi : RouteWifiNoScan);
+	if (!scan && sendCachedPage(PageWifiNoScan)) {
+		DEBUG_WM(F("Sent cached config page"));
+		return;
+	}
+
 	String page = FPSTR(HTTP_HEADER);
 	page.replace("{v}", "Config ESP");
 	page += FPSTR(HTTP_SCRIPT);
@@ -383,6 +909,7 @@ void SimpleWiFiManager::handleWifi(boolean scan) {
 	if (scan) {
 		int n = WiFi.scanNetworks();
 		DEBUG_WM(F("Scan done"));
+		traceScan(n);
 		if (n == 0) {
 			DEBUG_WM(F("No networks found"));
 			page += F("No networks found. Refresh to scan again.");
@@ -438,7 +965,7 @@ void SimpleWiFiManager::handleWifi(boolean scan) {
 					rssiQ += quality;
 					item.replace("{v}", WiFi.SSID(indices[i]));
 					item.replace("{r}", rssiQ);
-					if (WiFi.encryptionType(indices[i]) != ENC_TYPE_NONE) {
+					if (!isOpenNetwork(indices[i])) {
 						item.replace("{i}", "l");
 					}
 					else {
@@ -460,6 +987,7 @@ void SimpleWiFiManager::handleWifi(boolean scan) {
 
 	page += FPSTR(HTTP_FORM_START);
 
+#ifndef WM_NO_STATIC_IP_FIELDS
 	if (_sta_static_ip) {
 
 		String item = FPSTR(HTTP_FORM_PARAM);
@@ -491,28 +1019,34 @@ void SimpleWiFiManager::handleWifi(boolean scan) {
 
 		page += "<br/>";
 	}
+#endif
 
 	page += FPSTR(HTTP_FORM_END);
 	page += FPSTR(HTTP_SCAN_LINK);
 
 	page += FPSTR(HTTP_END);
 
-	server->sendHeader(String(F("Content-Length")), String(page.length()));
-	server->send(200, String(F("text/html")), page);
-
+	if (scan) {
+		server->sendHeader(String(F("Content-Length")), String(page.length()));
+		server->send(200, String(F("text/html")), page);
+	}
+	else {
+		sendAndCachePage(PageWifiNoScan, page);
+	}
 
 	DEBUG_WM(F("Sent config page"));
 }
 
 /** Handle the WLAN save form and redirect to WLAN config page again */
 void SimpleWiFiManager::handleWifiSave() {
-	_lastPortalHandle = millis();
+	portalUsed(RouteWifiSave);
 	DEBUG_WM(F("WiFi save"));
 
 	//SAVE/connect here
 	_ssid = server->arg("s").c_str();
 	_pass = server->arg("p").c_str();
 
+#ifndef WM_NO_STATIC_IP_FIELDS
 	if (server->arg(String(F("ip"))) != "") {
 		DEBUG_WM(F("static ip"));
 		DEBUG_WM(server->arg(String(F("ip"))));
@@ -532,6 +1066,9 @@ void SimpleWiFiManager::handleWifiSave() {
 		String sn = server->arg(String(F("sn")));
 		optionalIPFromString(&_sta_static_sn, sn.c_str());
 	}
+	//the static ip-fields of the config page may have changed
+	invalidatePageCache();
+#endif
 
 	String page = FPSTR(HTTP_HEADER);
 	page.replace(String(F("{v}")), String(F("Credentials Saved")));
@@ -540,6 +1077,7 @@ void SimpleWiFiManager::handleWifiSave() {
 	page += _customHeadElement;
 	page += FPSTR(HTTP_HEAD_END);
 	page += FPSTR(HTTP_SAVED);
+	page += FPSTR(HTTP_SCAN_LINK);
 	page += FPSTR(HTTP_END);
 
 	server->sendHeader(String(F("Content-Length")), String(page.length()));
@@ -548,12 +1086,20 @@ void SimpleWiFiManager::handleWifiSave() {
 	DEBUG_WM(F("Sent wifi save page"));
 
 	connect = true; //signal ready to connect/reset
+	_connectRequestTime = millis();
+	//the saved page subscribes before the trial starts, it must not see the old result
+	_reportedFailure = FailureNone;
 }
 
+#ifndef WM_NO_INFO_PAGE
 /** Handle the info page */
 void SimpleWiFiManager::handleInfo() {
-	_lastPortalHandle = millis();
+	portalUsed(RouteInfo);
 	DEBUG_WM(F("Info"));
+	if (sendCachedPage(PageInfo)) {
+		DEBUG_WM(F("Sent cached info page"));
+		return;
+	}
 
 	String page = FPSTR(HTTP_HEADER);
 	page.replace("{v}", "Info");
@@ -563,20 +1109,29 @@ void SimpleWiFiManager::handleInfo() {
 	page += FPSTR(HTTP_HEAD_END);
 	page += F("<dl>");
 	page += F("<dt>Chip ID</dt><dd>");
-	page += ESP.getChipId();
+	page += chipId();
 	page += F("</dd>");
+#if defined(ESP8266)
 	page += F("<dt>Flash Chip ID</dt><dd>");
 	page += ESP.getFlashChipId();
 	page += F("</dd>");
+#endif
 	page += F("<dt>IDE Flash Size</dt><dd>");
 	page += ESP.getFlashChipSize();
 	page += F(" bytes</dd>");
+#if defined(ESP8266)
 	page += F("<dt>Real Flash Size</dt><dd>");
 	page += ESP.getFlashChipRealSize();
 	page += F(" bytes</dd>");
+#endif
 	page += F("<dt>Soft AP IP</dt><dd>");
 	page += WiFi.softAPIP().toString();
 	page += F("</dd>");
+	page += F("<dt>Soft AP Channel</dt><dd>");
+	page += _apChannel;
+	page += F(" (score ");
+	page += _apChannelScore;
+	page += F(")</dd>");
 	page += F("<dt>Soft AP MAC</dt><dd>");
 	page += WiFi.softAPmacAddress();
 	page += F("</dd>");
@@ -586,15 +1141,16 @@ void SimpleWiFiManager::handleInfo() {
 	page += F("</dl>");
 	page += FPSTR(HTTP_END);
 
-	server->sendHeader("Content-Length", String(page.length()));
-	server->send(200, "text/html", page);
+	sendAndCachePage(PageInfo, page);
 
 	DEBUG_WM(F("Sent info page"));
 }
+#endif
 
+#ifndef WM_NO_RESET_PAGE
 /** Handle the reset page */
 void SimpleWiFiManager::handleReset() {
-	_lastPortalHandle = millis();
+	portalUsed(RouteReset);
 	DEBUG_WM(F("Reset"));
 
 	String page = FPSTR(HTTP_HEADER);
@@ -611,12 +1167,170 @@ void SimpleWiFiManager::handleReset() {
 
 	DEBUG_WM(F("Sent reset page"));
 	delay(5000);
-	ESP.reset();
+	resetChip();
 	delay(2000);
 }
+#endif
 
-void SimpleWiFiManager::handleNotFound() {
+#ifndef WM_NO_UPDATE
+/** Handle the firmware upload page */
+void SimpleWiFiManager::handleUpdate() {
+	portalUsed(RouteUpdate);
+	DEBUG_WM(F("Update"));
+
+	String page = FPSTR(HTTP_HEADER);
+	page.replace(String(F("{v}")), String(F("Update")));
+	page += FPSTR(HTTP_SCRIPT);
+	page += FPSTR(HTTP_STYLE);
+	page += _customHeadElement;
+	page += FPSTR(HTTP_HEAD_END);
+	page += FPSTR(HTTP_UPDATE_FORM);
+	page += FPSTR(HTTP_END);
+
+	server->sendHeader(String(F("Content-Length")), String(page.length()));
+	server->send(200, String(F("text/html")), page);
+
+	DEBUG_WM(F("Sent update page"));
+}
+
+/** Streams the uploaded firmware into the OTA partition. The Updater writes it sector by sector, so the image is never held in RAM. */
+void SimpleWiFiManager::handleUpdateUpload() {
 	_lastPortalHandle = millis();
+	HTTPUpload& upload = server->upload();
+
+	if (upload.status == UPLOAD_FILE_START) {
+		DEBUG_WM(F("Update start:"));
+		DEBUG_WM(upload.filename);
+		_updateError = "";
+		_updateStarted = true;
+		_updateSize = 0;
+		_updateStart = millis();
+		_updateStartHeap = ESP.getFreeHeap();
+		_updateMinHeap = _updateStartHeap;
+		//a previous upload that was cut off without an abort would block the Updater
+		if (Update.isRunning()) {
+			abortUpdate();
+		}
+
+		String md5 = server->arg(String(F("md5")));
+		//the partition must not be switched without a digest to verify against
+		if (md5.length() != 32) {
+			_updateError = F("Missing or invalid MD5.");
+			return;
+		}
+		uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+		if (!Update.begin(maxSketchSpace, U_FLASH)) {
+			_updateError = String(F("Update begin failed, error ")) + String(Update.getError());
+		}
+		else if (!Update.setMD5(md5.c_str())) {
+			_updateError = F("Invalid MD5.");
+			abortUpdate();
+		}
+		return;
+	}
+	if (_updateError.length() != 0) {
+		//keep receiving, but ignore the rest of a failed upload
+		return;
+	}
+
+	if (upload.status == UPLOAD_FILE_WRITE) {
+		if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
+			_updateError = String(F("Update write failed, error ")) + String(Update.getError());
+			abortUpdate();
+		}
+		uint32_t heap = ESP.getFreeHeap();
+		if (heap < _updateMinHeap) { _updateMinHeap = heap; }
+	}
+	else if (upload.status == UPLOAD_FILE_END) {
+		_updateDuration = millis() - _updateStart;
+		_updateSize = upload.totalSize;
+		//checks the MD5 of the written image before marking it for boot
+		if (!Update.end(true)) {
+			_updateError = String(F("Update verification failed, error ")) + String(Update.getError());
+		}
+		DEBUG_WM(F("Update size:"));
+		DEBUG_WM(_updateSize);
+	}
+	else if (upload.status == UPLOAD_FILE_ABORTED) {
+		abortUpdate();
+		_updateError = F("Update aborted.");
+		//the done handler is not called for a cut off upload
+		_updateStarted = false;
+	}
+	delay(0);
+}
+
+/** Releases the Updater after a failed upload. It keeps running otherwise and refuses every later upload until reboot. */
+void SimpleWiFiManager::abortUpdate() {
+#if defined(ESP32)
+	Update.abort();
+#else
+	//ends the update without marking the image for boot
+	Update.end();
+#endif
+}
+
+/** Handle the end of the firmware upload and reboot into the new firmware */
+void SimpleWiFiManager::handleUpdateDone() {
+	portalUsed(RouteUpdateDone);
+	//the web server only has an upload object while it parses a file, so only the values kept by handleUpdateUpload are used
+	if (!_updateStarted) {
+		_updateError = F("No firmware file uploaded.");
+	}
+	boolean success = _updateStarted && _updateError.length() == 0 && !Update.hasError();
+	int code = success ? 200 : _updateStarted ? 500 : 400;
+
+	uint32_t duration = _updateDuration != 0 ? _updateDuration : 1;
+
+	String result = FPSTR(HTTP_UPDATE_DONE);
+	result.replace(String(F("{r}")), success ? String(F("Update successful, rebooting.")) : _updateError);
+	result.replace(String(F("{s}")), String((unsigned long)_updateSize));
+	result.replace(String(F("{t}")), String(_updateDuration));
+	result.replace(String(F("{k}")), String((unsigned long)(_updateSize / duration)));
+	result.replace(String(F("{h}")), String(_updateStartHeap - _updateMinHeap));
+	DEBUG_WM(result);
+
+	String page = FPSTR(HTTP_HEADER);
+	page.replace(String(F("{v}")), String(F("Update")));
+	page += FPSTR(HTTP_SCRIPT);
+	page += FPSTR(HTTP_STYLE);
+	page += _customHeadElement;
+	page += FPSTR(HTTP_HEAD_END);
+	page += result;
+	page += FPSTR(HTTP_END);
+
+	server->sendHeader(String(F("Content-Length")), String(page.length()));
+	server->send(code, String(F("text/html")), page);
+
+	_updateDuration = 0;
+	_updateStarted = false;
+	if (success) {
+		DEBUG_WM(F("Sent update page, rebooting"));
+		delay(2000);
+		ESP.restart();
+	}
+}
+#endif
+
+/** Handle the status stream. The connection is kept open and gets a server-sent event for every status change and connect result. */
+void SimpleWiFiManager::handleEvents() {
+	portalUsed(RouteEvents);
+	DEBUG_WM(F("Events"));
+
+	//only one subscriber is supported, the newest one wins
+	_eventClient.stop();
+	_eventClient = server->client();
+	_eventClient.setNoDelay(true);
+	_eventClient.print(FPSTR(HTTP_EVENTS_HEADER));
+	sendEvent(F("status"), statusName(status));
+	//the client may have missed the result, e.g. while the AP changed its channel
+	if (_reportedFailure != FailureNone) {
+		sendEvent(F("result"), connectFailureName(_reportedFailure));
+	}
+}
+
+void SimpleWiFiManager::handleNotFound() {
+	portalUsed(RouteNotFound);
 	if (captivePortal()) { // If captive portal redirect instead of displaying the error page.
 		return;
 	}
@@ -645,6 +1359,7 @@ boolean SimpleWiFiManager::captivePortal() {
 	_lastPortalHandle = millis();
 	if (!isIp(server->hostHeader())) {
 		DEBUG_WM(F("Request redirected to captive portal"));
+		trace(TraceCaptiveRedirect);
 		server->sendHeader(String(F("Location")), String(F("http://")) + toStringIp(server->client().localIP()), true);
 		server->send(302, String(F("text/plain")).c_str()); // Empty content inhibits Content-length header so we have to close the socket ourselves.
 		server->client().stop(); // Stop is needed because we sent no content length
@@ -653,6 +1368,50 @@ boolean SimpleWiFiManager::captivePortal() {
 	return false;
 }
 
+void SimpleWiFiManager::clearPageCache() {
+	for (uint8_t i = 0; i < PageCount; i++) {
+		_pageCache[i] = String();
+		_pageCacheGeneration[i] = 0;
+	}
+}
+
+String SimpleWiFiManager::pageETag(CachedPage page) {
+	String etag = String(F("\""));
+	etag += String(_configGeneration, HEX);
+	etag += '-';
+	etag += (int)page;
+	etag += '"';
+	return etag;
+}
+
+boolean SimpleWiFiManager::sendCachedPage(CachedPage page) {
+	String etag = pageETag(page);
+	if (server->header(String(F("If-None-Match"))) == etag) {
+		DEBUG_WM(F("Page not modified"));
+		server->sendHeader(String(F("ETag")), etag);
+		server->send(304);
+		return true;
+	}
+	if (_pageCacheGeneration[page] != _configGeneration) {
+		return false;
+	}
+	server->sendHeader(String(F("Cache-Control")), String(F("no-cache")));
+	server->sendHeader(String(F("ETag")), etag);
+	server->sendHeader(String(F("Content-Length")), String(_pageCache[page].length()));
+	server->send(200, String(F("text/html")), _pageCache[page]);
+	return true;
+}
+
+void SimpleWiFiManager::sendAndCachePage(CachedPage page, const String& content) {
+	_pageCache[page] = content;
+	_pageCacheGeneration[page] = _configGeneration;
+
+	server->sendHeader(String(F("Cache-Control")), String(F("no-cache")));
+	server->sendHeader(String(F("ETag")), pageETag(page));
+	server->sendHeader(String(F("Content-Length")), String(content.length()));
+	server->send(200, String(F("text/html")), content);
+}
+
 const char PROGMEM WM_DEBUG_PREFIX[] = { "*WM: " };
 
 template <typename Generic>
@@ -666,6 +1425,110 @@ void SimpleWiFiManager::DEBUG_WM(Generic text) {
 	}
 }
 
+#ifdef WM_TRACE
+void SimpleWiFiManager::trace(TraceEvent event, uint8_t value, int16_t detail) {
+	TraceEntry& entry = _trace[_traceNext];
+	entry.time = millis();
+	entry.event = event;
+	entry.value = value;
+	entry.detail = detail;
+	if (++_traceNext == WM_TRACE_SIZE) {
+		_traceNext = 0;
+		_traceWrapped = true;
+	}
+}
+
+void SimpleWiFiManager::traceScan(int networkCount) {
+	int bestRSSI = -128;
+	for (int i = 0; i < networkCount; i++) {
+		if (WiFi.RSSI(i) > bestRSSI) { bestRSSI = WiFi.RSSI(i); }
+	}
+	trace(TraceScan, networkCount < 0 ? 0 : networkCount, bestRSSI);
+}
+
+void SimpleWiFiManager::dumpTrace(Print& output) {
+	uint16_t count = _traceWrapped ? WM_TRACE_SIZE : _traceNext;
+	uint16_t first = _traceWrapped ? _traceNext : 0;
+	for (uint16_t i = 0; i < count; i++) {
+		const TraceEntry& entry = _trace[(first + i) % WM_TRACE_SIZE];
+		output.print(entry.time);
+		output.print(' ');
+		output.print(entry.event);
+		output.print(' ');
+		output.print(entry.value);
+		output.print(' ');
+		output.println(entry.detail);
+	}
+}
+
+/** Handle the trace download. The entries are sent oldest first in their binary form, after a 4 byte format header */
+void SimpleWiFiManager::handleTrace() {
+	portalUsed(RouteTrace);
+	uint16_t count = _traceWrapped ? WM_TRACE_SIZE : _traceNext;
+
+	const uint8_t header[] = { 'W', 'M', 'T', 1 };
+	server->setContentLength(sizeof(header) + count * sizeof(TraceEntry));
+	server->send(200, String(F("application/octet-stream")), String());
+	server->client().write(header, sizeof(header));
+	if (_traceWrapped) {
+		server->client().write((const uint8_t*)&_trace[_traceNext], (WM_TRACE_SIZE - _traceNext) * sizeof(TraceEntry));
+	}
+	server->client().write((const uint8_t*)&_trace[0], _traceNext * sizeof(TraceEntry));
+
+	DEBUG_WM(F("Sent trace"));
+}
+#endif
+
+const __FlashStringHelper* SimpleWiFiManager::statusName(ManagerStatus managerStatus) {
+	switch (managerStatus)
+	{
+	case SimpleWiFiManager::Idle:
+		return F("Idle");
+	case SimpleWiFiManager::ConnectingSaved:
+		return F("Connecting with saved credentials");
+	case SimpleWiFiManager::ConnectingWPS:
+		return F("Connecting with WPS");
+	case SimpleWiFiManager::StartingAP:
+		return F("Selecting the access point channel");
+	case SimpleWiFiManager::HandlingAP:
+		return F("Waiting for credentials");
+	case SimpleWiFiManager::ConnectingAP:
+		return F("Connecting with new credentials");
+	default:
+		return F("Unknown");
+	}
+}
+
+const __FlashStringHelper* SimpleWiFiManager::connectFailureName(ConnectFailure failure) {
+	switch (failure)
+	{
+	case SimpleWiFiManager::FailureNone:
+		return F("No failure.");
+	case SimpleWiFiManager::FailureWrongPassword:
+		return F("Connect failed: wrong password.");
+	case SimpleWiFiManager::FailureSSIDNotFound:
+		return F("Connect failed: SSID not found.");
+	case SimpleWiFiManager::FailureDHCPTimeout:
+		return F("Connect failed: DHCP timeout.");
+	case SimpleWiFiManager::FailureTimeout:
+		return F("Connect timed out.");
+	default:
+		return F("Connect failed.");
+	}
+}
+
+void SimpleWiFiManager::sendEvent(const __FlashStringHelper* event, const String& data) {
+	if (!_eventClient.connected()) {
+		return;
+	}
+	String frame = F("event: ");
+	frame += event;
+	frame += F("\ndata: ");
+	frame += data;
+	frame += F("\n\n");
+	_eventClient.print(frame);
+}
+
 int SimpleWiFiManager::getRSSIasQuality(int RSSI) {
 	int quality = 0;
 
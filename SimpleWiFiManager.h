@@ -9,27 +9,90 @@
 #ifndef SimpleWiFiManager_h
 #define SimpleWiFiManager_h
 
+//The platform is selected at compile time, so there is no runtime dispatch.
+#if defined(ESP8266)
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
-#include <DNSServer.h>
-#include <memory>
 
 extern "C" {
   #include "user_interface.h"
 }
 
+typedef ESP8266WebServer WiFiManagerWebServer;
+#elif defined(ESP32)
+#include <WiFi.h>
+#include <WebServer.h>
+#include <esp_wifi.h>
+
+typedef WebServer WiFiManagerWebServer;
+#elif defined(WM_HOST)
+//the simulated backend of the unit tests, see test/host
+#include <WiFiManagerHost.h>
+
+typedef HostWebServer WiFiManagerWebServer;
+#else
+#error "SimpleWiFiManager only supports the ESP8266 and ESP32 platforms, or the host backend with WM_HOST."
+#endif
+
+#include <DNSServer.h>
+#include <memory>
+
+//Optional parts of the portal can be removed to save flash and RAM, by defining these as build flags:
+//WM_NO_INFO_PAGE         removes the info page (/i)
+//WM_NO_NOSCAN_PAGE       removes the config page without scan (/0wifi)
+//WM_NO_RESET_PAGE        removes the reset route (/r)
+//WM_NO_STATIC_IP_FIELDS  removes the static ip fields from the config page
+//WM_NO_LOCK_ICON         removes the inline icon of encrypted networks
+//WM_NO_WPS               removes the WPS fallback
+//WM_NO_UPDATE            removes the firmware upload (/update)
+//extras/footprint.sh reports what each of them costs.
+//
+//WM_TRACE                records a trace of the connect-process in a ring buffer of WM_TRACE_SIZE events,
+//                        see dumpTrace() and the /trace route, extras/trace.js decodes it.
+
+//WPS needs the extra 4k heap of the ESP8266 core, the host backend simulates it
+#if (defined(ESP8266) && defined(NO_EXTRA_4K_HEAP) || defined(WM_HOST)) && !defined(WM_NO_WPS)
+#define WM_WPS
+#endif
+
+#if defined(WM_TRACE) && !defined(WM_TRACE_SIZE)
+#define WM_TRACE_SIZE 128
+#endif
+
 const char HTTP_HEADER[] PROGMEM            = "<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"UTF-8\" name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/><title>{v}</title>";
-const char HTTP_STYLE[] PROGMEM           = "<style>.c{text-align: center;} div,input{padding:5px;font-size:1em;} input{width:95%;} body{text-align: center;font-family:verdana;} button{border:0;border-radius:0.3rem;background-color:#1fa3ec;color:#fff;line-height:2.4rem;font-size:1.2rem;width:100%;} .q{float: right;width: 64px;text-align: right;} .l{background: url(\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAACAAAAAgCAMAAABEpIrGAAAALVBMVEX///8EBwfBwsLw8PAzNjaCg4NTVVUjJiZDRUUUFxdiZGSho6OSk5Pg4eFydHTCjaf3AAAAZElEQVQ4je2NSw7AIAhEBamKn97/uMXEGBvozkWb9C2Zx4xzWykBhFAeYp9gkLyZE0zIMno9n4g19hmdY39scwqVkOXaxph0ZCXQcqxSpgQpONa59wkRDOL93eAXvimwlbPbwwVAegLS1HGfZAAAAABJRU5ErkJggg==\") no-repeat left center;background-size: 1em;}</style>";
+const char HTTP_STYLE[] PROGMEM           = "<style>.c{text-align: center;} div,input{padding:5px;font-size:1em;} input{width:95%;} body{text-align: center;font-family:verdana;} button{border:0;border-radius:0.3rem;background-color:#1fa3ec;color:#fff;line-height:2.4rem;font-size:1.2rem;width:100%;} .q{float: right;width: 64px;text-align: right;}"
+#ifndef WM_NO_LOCK_ICON
+	" .l{background: url(\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAACAAAAAgCAMAAABEpIrGAAAALVBMVEX///8EBwfBwsLw8PAzNjaCg4NTVVUjJiZDRUUUFxdiZGSho6OSk5Pg4eFydHTCjaf3AAAAZElEQVQ4je2NSw7AIAhEBamKn97/uMXEGBvozkWb9C2Zx4xzWykBhFAeYp9gkLyZE0zIMno9n4g19hmdY39scwqVkOXaxph0ZCXQcqxSpgQpONa59wkRDOL93eAXvimwlbPbwwVAegLS1HGfZAAAAABJRU5ErkJggg==\") no-repeat left center;background-size: 1em;}"
+#endif
+	"</style>";
 const char HTTP_SCRIPT[] PROGMEM          = "<script>function c(l){document.getElementById('s').value=l.innerText||l.textContent;document.getElementById('p').focus();}</script>";
 const char HTTP_HEAD_END[] PROGMEM        = "</head><body><div style='text-align:left;display:inline-block;min-width:260px;'>";
-const char HTTP_PORTAL_OPTIONS[] PROGMEM  = "<form action=\"/wifi\" method=\"get\"><button>Configure WiFi</button></form><br/><form action=\"/0wifi\" method=\"get\"><button>Configure WiFi (No Scan)</button></form><br/><form action=\"/i\" method=\"get\"><button>Info</button></form><br/><form action=\"/r\" method=\"post\"><button>Reset</button></form>";
+const char HTTP_PORTAL_OPTIONS[] PROGMEM  = "<form action=\"/wifi\" method=\"get\"><button>Configure WiFi</button></form>"
+#ifndef WM_NO_NOSCAN_PAGE
+	"<br/><form action=\"/0wifi\" method=\"get\"><button>Configure WiFi (No Scan)</button></form>"
+#endif
+#ifndef WM_NO_INFO_PAGE
+	"<br/><form action=\"/i\" method=\"get\"><button>Info</button></form>"
+#endif
+#ifndef WM_NO_RESET_PAGE
+	"<br/><form action=\"/r\" method=\"post\"><button>Reset</button></form>"
+#endif
+	;
 const char HTTP_ITEM[] PROGMEM            = "<div><a href='#p' onclick='c(this)'>{v}</a>&nbsp;<span class='q {i}'>{r}%</span></div>";
 const char HTTP_FORM_START[] PROGMEM      = "<form method='get' action='wifisave'><input id='s' name='s' length=32 placeholder='SSID'><br/><input id='p' name='p' length=64 type='password' placeholder='password'><br/>";
+#ifndef WM_NO_STATIC_IP_FIELDS
 const char HTTP_FORM_PARAM[] PROGMEM      = "<br/><input id='{i}' name='{n}' maxlength={l} placeholder='{p}' value='{v}' {c}>";
+#endif
 const char HTTP_FORM_END[] PROGMEM        = "<br/><button type='submit'>save</button></form>";
 const char HTTP_SCAN_LINK[] PROGMEM       = "<br/><div class=\"c\"><a href=\"/wifi\">Scan</a></div>";
-const char HTTP_SAVED[] PROGMEM           = "<div>Credentials Saved<br />Trying to connect ESP to network.<br />If it fails reconnect to AP to try again</div>";
+const char HTTP_SAVED[] PROGMEM           = "<div>Credentials Saved<br />Trying to connect ESP to network.<br />The credentials are only kept, if the connect succeeds. If it fails, the reason is shown below.</div><br/><div id='e'></div><script>var s=new EventSource('/events'),l=function(m){document.getElementById('e').innerHTML+=m.data+'<br/>';};s.addEventListener('status',l);s.addEventListener('result',l);</script>";
+const char HTTP_EVENTS_HEADER[] PROGMEM   = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\nretry: 1000\n\n";
 const char HTTP_END[] PROGMEM             = "</div></body></html>";
+#ifndef WM_NO_UPDATE
+const char HTTP_PORTAL_UPDATE[] PROGMEM   = "<br/><form action=\"/update\" method=\"get\"><button>Update</button></form>";
+const char HTTP_UPDATE_FORM[] PROGMEM     = "<form method='post' enctype='multipart/form-data' onsubmit=\"this.action='update?md5='+document.getElementById('m').value\"><input type='file' name='firmware' accept='.bin'><br/><input id='m' length=32 placeholder='MD5 of the firmware'><br/><button type='submit'>Update</button></form>";
+const char HTTP_UPDATE_DONE[] PROGMEM     = "<div>{r}<br/>{s} bytes in {t} ms ({k} kB/s), peak heap usage {h} bytes</div>";
+#endif
 
 const char DEFAULT_APNAME[] PROGMEM       = "no-net";
 
@@ -70,27 +133,74 @@ class SimpleWiFiManager
 	void			setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn);
 	//sets config for a static IP
 	void			setSTAStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn);
+	//sets the channel of the config portal AP, 0 selects the least congested channel - default 0
+	//When the station is already connected, its channel is always used.
+	inline void		setAPChannel(uint8_t channel);
+	//Returns the channel of the last started config portal AP.
+	inline uint8_t	getAPChannel() { return _apChannel; }
+	//Returns the congestion score of the channel of the config portal AP, lower is better.
+	//Returns 0, if the channel was not selected automatically.
+	inline uint32_t	getAPChannelScore() { return _apChannelScore; }
 	//called when AP mode and config portal is started
 	inline void		setAPCallback( void (*func)(SimpleWiFiManager*) );
-	//if this is set, try WPS setup when starting (this will delay config portal for up to 2 mins)
-	//TODO
+#ifdef WM_WPS
+	//if this is set, try WPS push-button setup when the saved credentials fail - default false
+	//The config portal is started, if WPS did not succeed within timeout seconds.
+	inline void		setTryWPS(boolean tryWPS, unsigned long timeout = 120);
+#endif
 	//if this is set, customise style
 	inline void		setCustomHeadElement(const char* element);
 	//if this is true, remove duplicated Access Points - defaut true
 	inline void		setRemoveDuplicateAPs(boolean removeDuplicates);
+#ifndef WM_NO_UPDATE
+	//if this is true, the portal offers a firmware upload at /update - default false
+	//The uploaded image is only booted, if it matches the MD5 entered with it.
+	inline void		setOTAUpdateEnabled(boolean enabled);
+#endif
+
+	//stops the DNS and HTTP server of the portal, after no station was connected and the portal was not used for this time, 0 disables - default 0
+	//They are started again, when a station connects to the AP.
+	inline void		setPortalIdleTimeout(unsigned long seconds) { _portalIdleTimeout = seconds * 1000; }
+	//shuts the config portal AP down, after no station was connected and the portal was not used for this time, 0 disables - default 0
+	//HandleConnecting returns true afterwards without being connected, and TimedOut() tells it apart from a connect.
+	inline void		setAPTimeout(unsigned long seconds) { _apTimeout = seconds * 1000; }
 
 	//Check if there are clients connected to the AP
 	inline bool		HasConnectedClients() {
-		return wifi_softap_get_station_num() != 0;
+		return softAPStationCount() != 0;
 	}
 
 	//Call this function periodicaly
+	//Returns true, when the connect-process ended: connected, or the AP timed out, see TimedOut().
 	boolean			HandleConnecting();
 	//Use this to abort a running connect-process
 	void			FinishConnecting();
 
 	//Use this function to check, if the manager is currently trying to connect
 	boolean			IsConnecting();
+	//Use this function to check, if the last connect-process ended, because the AP timed out unused
+	inline boolean	TimedOut() { return _timedOut; }
+
+	//Enables the link-quality monitor - default disabled
+	//When the smoothed RSSI stays below rssiThreshold (dBm), the SSID is scanned for a BSSID
+	//that is at least hysteresis dB stronger and the station roams there.
+	void			setRoaming(boolean enabled, int rssiThreshold = -75, uint8_t hysteresis = 8);
+	//Call this function periodicaly while connected, to monitor the link and roam if needed
+	void			HandleLinkQuality();
+	//Returns the number of successful roams.
+	inline uint16_t	getRoamCount() { return _roamCount; }
+	//Returns the time spent roaming in milliseconds.
+	inline uint32_t	getRoamTime() { return _roamTime; }
+	//Returns the average of the last RSSI samples, 0 if there are none.
+	int				getSmoothedRSSI();
+	//Returns the lowest and highest RSSI sampled by the monitor, 0 and -128 before the first sample.
+	inline int		getMinRSSI() { return _rssiMin; }
+	inline int		getMaxRSSI() { return _rssiMax; }
+
+#ifdef WM_TRACE
+	//Writes the recorded trace as text, one event per line with: millis, event, value, detail
+	void			dumpTrace(Print& output);
+#endif
 
 	//This function gets the time since the last HTTP-handling was done in milliseconds.
 	//Returns UINT32_MAX, if no HTTP-handling was done before.
@@ -98,14 +208,58 @@ class SimpleWiFiManager
 
   private:
 	std::unique_ptr<DNSServer>        dnsServer;
-	std::unique_ptr<ESP8266WebServer> server;
+	std::unique_ptr<WiFiManagerWebServer> server;
 
 	enum ManagerStatus {
 		Idle = 0,
 		ConnectingSaved = 1,
 		ConnectingWPS = 2,
 		HandlingAP = 3,
-		ConnectingAP = 4
+		ConnectingAP = 4,
+		StartingAP = 5
+	};
+
+	//reason of the last failed connect-attempt
+	enum ConnectFailure {
+		FailureNone = 0,
+		FailureWrongPassword = 1,
+		FailureSSIDNotFound = 2,
+		FailureDHCPTimeout = 3,
+		FailureTimeout = 4,
+		FailureOther = 5
+	};
+
+	//events of the trace, the values are part of the trace format read by extras/trace.js
+	enum TraceEvent {
+		TraceStatus = 0,			//value: ManagerStatus
+		TraceWiFiStatus = 1,		//value: wl_status_t, only recorded on change
+		TraceConnectFailure = 2,	//value: ConnectFailure
+		TraceScan = 3,				//value: network count, detail: best RSSI
+		TraceAPChannel = 4,			//value: channel, detail: score (clamped)
+		TraceRoute = 5,				//value: TraceRouteId
+		TraceCaptiveRedirect = 6,
+		TracePortalServers = 7,		//value: 1 started, 0 stopped
+		TraceRoam = 8				//value: TraceRoamStart, TraceRoamDone or TraceRoamFailed, detail: RSSI
+	};
+
+	enum TraceRoamStep {
+		TraceRoamStart = 0,
+		TraceRoamDone = 1,
+		TraceRoamFailed = 2
+	};
+
+	enum TraceRouteId {
+		RouteRoot = 0,
+		RouteWifi = 1,
+		RouteWifiNoScan = 2,
+		RouteWifiSave = 3,
+		RouteInfo = 4,
+		RouteReset = 5,
+		RouteUpdate = 6,
+		RouteUpdateDone = 7,
+		RouteEvents = 8,
+		RouteTrace = 9,
+		RouteNotFound = 10
 	};
 
 	//const int     WM_DONE                 = 0;
@@ -114,10 +268,26 @@ class SimpleWiFiManager
 	//const String  HTTP_HEADER = "<!DOCTYPE html><html lang=\"en\"><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"/><title>{v}</title>";
 
 	void			initConfigPortal();
+	void			startAccessPoint(boolean keepStation);
+	void			startFallback();
+	void			startPortalServers();
+	void			stopPortalServers();
+	boolean			reclaimPortal();
+	void			handlePortal();
+	void			setStatus(ManagerStatus newStatus);
 	void			setupConfigPortal();
+	void			startSoftAP();
+	void			followRouterChannel(const String& ssid);
+#ifdef WM_WPS
 	void			startWPS();
+	void			stopWPS();
+	static void		wpsStatusCallback(int wpsStatus);
+#endif
+	boolean			startAPChannelScan();
+	boolean			selectAPChannel();
 	void			cacheAP(const char* const Name, const char* const Password);
 	wl_status_t		handleWaitConnect();
+	void			endCredentialTrial(boolean success);
 
 	const char*		_apName                 = NULL;
 	const char*		_apPassword             = NULL;
@@ -125,8 +295,64 @@ class SimpleWiFiManager
 	String			_pass                   = "";
 	unsigned long	_connectTimeout         = 5000;
 
+	uint8_t			_apChannelOverride      = 0;
+	uint8_t			_apChannel              = 1;
+	uint32_t		_apChannelScore         = 0;
+	uint32_t		_apChannelScanStart     = 0;
+
 	uint32_t		_lastPortalHandle		= 0;
+	uint32_t		_lastStationSeen        = 0;
+	unsigned long	_portalIdleTimeout      = 0;
+	unsigned long	_apTimeout              = 0;
+	boolean			_timedOut               = false;
+
+	//link-quality monitor
+	static const uint8_t RSSI_HISTORY_SIZE  = 8;
+	static const uint16_t RSSI_SAMPLE_INTERVAL = 2000;
+	static const uint32_t ROAM_SCAN_INTERVAL = 60000;
+	boolean			_roamingEnabled         = false;
+	int				_roamThreshold          = -75;
+	uint8_t			_roamHysteresis         = 8;
+	int8_t			_rssiHistory[RSSI_HISTORY_SIZE];
+	uint8_t			_rssiNext               = 0;
+	uint8_t			_rssiCount              = 0;
+	int				_rssiMin                = 0;
+	int				_rssiMax                = -128;
+	uint32_t		_lastRSSISample         = 0;
+	uint32_t		_lastRoamScan           = 0;
+	boolean			_roamScanning           = false;
+	boolean			_roaming                = false;
+	uint32_t		_roamStart              = 0;
+	uint16_t		_roamCount              = 0;
+	uint32_t		_roamTime               = 0;
+	//the async scan reads the SSID while it runs
+	String			_roamSSID;
+	uint8_t			_roamBSSID[6];
+
+	void			roamToBestBSSID(int networkCount);
+	void			unpinBSSID(boolean reconnect);
+	inline void		portalUsed(TraceRouteId route);
 	uint32_t		_connectStart;
+	uint32_t		_connectRequestTime     = 0;
+	ConnectFailure	_connectFailure         = FailureNone;
+	//failure of the last finished attempt, sent to new subscribers of the status stream
+	ConnectFailure	_reportedFailure        = FailureNone;
+#if defined(ESP8266) || defined(WM_HOST)
+	//set and cleared by the station events
+	boolean			_staAssociated          = false;
+	WiFiEventHandler _staConnectedHandler;
+	WiFiEventHandler _staDisconnectedHandler;
+	//set by the soft-AP event, when a station joined
+	volatile boolean _stationJoined         = false;
+	WiFiEventHandler _apStationConnectedHandler;
+#elif defined(ESP32)
+	//reason of the last station disconnect, set by the WiFi event
+	volatile uint8_t _staDisconnectReason   = 0;
+	wifi_event_id_t	_staDisconnectedEvent   = 0;
+#endif
+
+	//client of the /events status stream
+	WiFiClient		_eventClient;
 
 	IPAddress		_ap_static_ip;
 	IPAddress		_ap_static_gw;
@@ -137,10 +363,32 @@ class SimpleWiFiManager
 
 	int				_minimumQuality         = -1;
 	boolean			_removeDuplicateAPs     = true;
+#ifdef WM_WPS
 	boolean			_tryWPS                 = false;
+	unsigned long	_wpsTimeout             = 120000;
+	uint32_t		_wpsStart;
+	//true, after WPS got the credentials and the station is connecting
+	boolean			_wpsConnecting          = false;
+	//set by the SDK callback, WPS_PENDING while WPS is running
+	static volatile int _wpsResult;
+	static const int WPS_PENDING            = -1;
+#endif
 
 	const char*		_customHeadElement      = "";
 
+#ifndef WM_NO_UPDATE
+	//firmware upload
+	boolean			_otaEnabled             = false;
+	String			_updateError;
+	//set when the upload of a file started, a POST without a file never calls the upload handler
+	boolean			_updateStarted          = false;
+	size_t			_updateSize             = 0;
+	uint32_t		_updateStart            = 0;
+	uint32_t		_updateDuration         = 0;
+	uint32_t		_updateStartHeap        = 0;
+	uint32_t		_updateMinHeap          = 0;
+#endif
+
 	//String        getEEPROMString(int start, int len);
 	//void          setEEPROMString(int start, int len, String string);
 
@@ -149,20 +397,106 @@ class SimpleWiFiManager
 	void			handleRoot();
 	void			handleWifi(boolean scan);
 	void			handleWifiSave();
+#ifndef WM_NO_INFO_PAGE
 	void			handleInfo();
+#endif
+#ifndef WM_NO_RESET_PAGE
 	void			handleReset();
+#endif
+#ifndef WM_NO_UPDATE
+	void			handleUpdate();
+	void			handleUpdateUpload();
+	void			handleUpdateDone();
+	void			abortUpdate();
+#endif
 	void			handleNotFound();
+	void			handleEvents();
 	void			handle204();
 	boolean			captivePortal();
 
 	// DNS server
 	const byte		DNS_PORT = 53;
 
+	//the highest channel setAPChannel() accepts, the selection keeps to the channels of the country
+	static const uint8_t MAX_AP_CHANNEL = 13;
+	//the channels allowed everywhere, used if the country is unknown
+	static const uint8_t DEFAULT_AP_CHANNELS = 11;
+	static const uint16_t AP_CHANNEL_SCAN_TIMEOUT = 10000;
+
+	//platform helpers
+	static inline uint32_t	chipId();
+	static inline uint32_t	hardwareRandom();
+	static inline uint8_t	softAPStationCount();
+	static inline boolean	isOpenNetwork(int networkIndex);
+	static inline void		stationDisconnect();
+	static inline void		resetChip();
+	static inline void		startSSIDScan(const String& ssid);
+	inline ConnectFailure	stationFailure();
+	static inline void		persistStationConfig(boolean persist);
+	static inline void		commitStationConfig();
+	static inline void		clearStationBSSID();
+	static inline boolean	countryChannels(uint8_t& first, uint8_t& count);
+	inline boolean			stationAssociated();
+#ifdef WM_WPS
+	static inline boolean	wpsStart();
+	static inline void		wpsStop();
+	static inline void		stationConnect();
+#endif
+
+	//trace
+#ifdef WM_TRACE
+	struct TraceEntry {
+		uint32_t	time;
+		uint8_t		event;
+		uint8_t		value;
+		int16_t		detail;
+	};
+	static_assert(sizeof(TraceEntry) == 8, "the trace format expects 8 byte entries");
+	TraceEntry		_trace[WM_TRACE_SIZE];
+	uint16_t		_traceNext              = 0;
+	boolean			_traceWrapped           = false;
+	uint8_t			_traceWiFiStatus        = 0xFF;
+
+	void			trace(TraceEvent event, uint8_t value = 0, int16_t detail = 0);
+	void			traceScan(int networkCount);
+	void			handleTrace();
+#else
+	inline void		trace(TraceEvent, uint8_t = 0, int16_t = 0) {}
+	inline void		traceScan(int) {}
+#endif
+
 	//helpers
+	const __FlashStringHelper* statusName(ManagerStatus managerStatus);
+	const __FlashStringHelper* connectFailureName(ConnectFailure failure);
+	void			reportConnectFailure();
+	void			sendEvent(const __FlashStringHelper* event, const String& data);
 	int				getRSSIasQuality(int RSSI);
 	boolean			isIp(String str);
 	String			toStringIp(IPAddress ip);
 
+	//page-cache
+	enum CachedPage {
+		PageRoot = 0,
+		PageInfo = 1,
+		PageWifiNoScan = 2,
+		PageCount = 3
+	};
+
+	//Gets incremented whenever something changes, that is shown on the cached pages.
+	//Is never 0, so a cache-entry with generation 0 is always invalid.
+	uint32_t		_configGeneration;
+	uint32_t		_pageCacheGeneration[PageCount] = {};
+	String			_pageCache[PageCount];
+
+	inline void		invalidatePageCache();
+	void			clearPageCache();
+	String			pageETag(CachedPage page);
+	//Answers the request with a 304 or from the page-cache, if the cached page is still valid.
+	//Returns true, if the request was answered.
+	boolean			sendCachedPage(CachedPage page);
+	//Stores the page in the page-cache and sends it.
+	void			sendAndCachePage(CachedPage page, const String& content);
+
 	boolean			connect;
 	boolean			_debug = true;
 	ManagerStatus	status = ManagerStatus::Idle;
@@ -183,19 +517,315 @@ class SimpleWiFiManager
 	}
 };
 
+inline void SimpleWiFiManager::portalUsed(TraceRouteId route) {
+	_lastPortalHandle = millis();
+	trace(TraceRoute, route);
+}
+
 uint32_t SimpleWiFiManager::MillisSinceLastPortalUsage() {
 	if (_lastPortalHandle == 0) { return UINT32_MAX; }
 	return millis() - _lastPortalHandle;
 }
 
+#if defined(ESP8266)
+inline uint32_t SimpleWiFiManager::chipId() {
+	return ESP.getChipId();
+}
+
+inline uint32_t SimpleWiFiManager::hardwareRandom() {
+	return os_random();
+}
+
+inline uint8_t SimpleWiFiManager::softAPStationCount() {
+	return wifi_softap_get_station_num();
+}
+
+inline boolean SimpleWiFiManager::isOpenNetwork(int networkIndex) {
+	return WiFi.encryptionType(networkIndex) == ENC_TYPE_NONE;
+}
+
+inline void SimpleWiFiManager::stationDisconnect() {
+	//trying to fix connection in progress hanging
+	ETS_UART_INTR_DISABLE();
+	wifi_station_disconnect();
+	ETS_UART_INTR_ENABLE();
+}
+
+inline void SimpleWiFiManager::resetChip() {
+	ESP.reset();
+}
+
+inline void SimpleWiFiManager::startSSIDScan(const String& ssid) {
+	WiFi.scanNetworks(true, false, 0, (uint8_t*)ssid.c_str());
+}
+
+inline SimpleWiFiManager::ConnectFailure SimpleWiFiManager::stationFailure() {
+	switch (wifi_station_get_connect_status()) {
+	case STATION_WRONG_PASSWORD:
+		return FailureWrongPassword;
+	case STATION_NO_AP_FOUND:
+		return FailureSSIDNotFound;
+	case STATION_CONNECT_FAIL:
+		return FailureOther;
+	default:
+		return FailureNone;
+	}
+}
+
+inline void SimpleWiFiManager::persistStationConfig(boolean persist) {
+	WiFi.persistent(persist);
+}
+
+inline void SimpleWiFiManager::commitStationConfig() {
+	//writing the current config again stores it in flash
+	struct station_config conf;
+	wifi_station_get_config(&conf);
+	wifi_station_set_config(&conf);
+}
+
+inline void SimpleWiFiManager::clearStationBSSID() {
+	//only the current config, the connection stays up
+	struct station_config conf;
+	wifi_station_get_config(&conf);
+	conf.bssid_set = 0;
+	wifi_station_set_config_current(&conf);
+}
+
+inline boolean SimpleWiFiManager::countryChannels(uint8_t& first, uint8_t& count) {
+	wifi_country_t country;
+	if (!wifi_get_country(&country)) {
+		return false;
+	}
+	first = country.schan;
+	count = country.nchan;
+	return true;
+}
+
+inline boolean SimpleWiFiManager::stationAssociated() {
+	return _staAssociated;
+}
+
+#ifdef WM_WPS
+inline boolean SimpleWiFiManager::wpsStart() {
+	wifi_wps_disable();
+	return wifi_wps_enable(WPS_TYPE_PBC) && wifi_set_wps_cb(&SimpleWiFiManager::wpsStatusCallback) && wifi_wps_start();
+}
+
+inline void SimpleWiFiManager::wpsStop() {
+	wifi_wps_disable();
+}
+
+inline void SimpleWiFiManager::stationConnect() {
+	wifi_station_connect();
+}
+#endif
+#elif defined(ESP32)
+inline uint32_t SimpleWiFiManager::chipId() {
+	//the lower bytes of the factory MAC are unique per chip, like the ESP8266 chip id
+	return (uint32_t)(ESP.getEfuseMac() >> 24);
+}
+
+inline uint32_t SimpleWiFiManager::hardwareRandom() {
+	return esp_random();
+}
+
+inline uint8_t SimpleWiFiManager::softAPStationCount() {
+	return WiFi.softAPgetStationNum();
+}
+
+inline boolean SimpleWiFiManager::isOpenNetwork(int networkIndex) {
+	return WiFi.encryptionType(networkIndex) == WIFI_AUTH_OPEN;
+}
+
+inline void SimpleWiFiManager::stationDisconnect() {
+	esp_wifi_disconnect();
+}
+
+inline void SimpleWiFiManager::resetChip() {
+	ESP.restart();
+}
+
+inline void SimpleWiFiManager::startSSIDScan(const String& ssid) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 2
+	WiFi.scanNetworks(true, false, false, 300, 0, ssid.c_str());
+#else
+	//arduino-esp32 1.x can not scan for a single SSID, the results are filtered by SSID anyway
+	(void)ssid;
+	WiFi.scanNetworks(true);
+#endif
+}
+
+inline SimpleWiFiManager::ConnectFailure SimpleWiFiManager::stationFailure() {
+	//the arduino-esp32 status does not tell a wrong password apart from other failures, the disconnect reason does
+	switch (_staDisconnectReason) {
+	case WIFI_REASON_AUTH_FAIL:
+	case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+		return FailureWrongPassword;
+	case WIFI_REASON_NO_AP_FOUND:
+		return FailureSSIDNotFound;
+	default:
+		break;
+	}
+	switch (WiFi.status()) {
+	case WL_NO_SSID_AVAIL:
+		return FailureSSIDNotFound;
+	case WL_CONNECT_FAILED:
+		return FailureOther;
+	default:
+		return FailureNone;
+	}
+}
+
+inline void SimpleWiFiManager::persistStationConfig(boolean persist) {
+	WiFi.persistent(persist);
+	esp_wifi_set_storage(persist ? WIFI_STORAGE_FLASH : WIFI_STORAGE_RAM);
+}
+
+inline void SimpleWiFiManager::commitStationConfig() {
+	wifi_config_t conf;
+	esp_wifi_get_config(WIFI_IF_STA, &conf);
+	esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+	esp_wifi_set_config(WIFI_IF_STA, &conf);
+}
+
+inline void SimpleWiFiManager::clearStationBSSID() {
+	//WiFi.begin() would disconnect, because the config differs
+	wifi_config_t conf;
+	esp_wifi_get_config(WIFI_IF_STA, &conf);
+	conf.sta.bssid_set = 0;
+	esp_wifi_set_config(WIFI_IF_STA, &conf);
+}
+
+inline boolean SimpleWiFiManager::countryChannels(uint8_t& first, uint8_t& count) {
+	wifi_country_t country;
+	if (esp_wifi_get_country(&country) != ESP_OK) {
+		return false;
+	}
+	first = country.schan;
+	count = country.nchan;
+	return true;
+}
+
+inline boolean SimpleWiFiManager::stationAssociated() {
+	wifi_ap_record_t info;
+	return esp_wifi_sta_get_ap_info(&info) == ESP_OK;
+}
+#elif defined(WM_HOST)
+inline uint32_t SimpleWiFiManager::chipId() {
+	return ESP.getChipId();
+}
+
+inline uint32_t SimpleWiFiManager::hardwareRandom() {
+	return host::random();
+}
+
+inline uint8_t SimpleWiFiManager::softAPStationCount() {
+	return WiFi.softAPgetStationNum();
+}
+
+inline boolean SimpleWiFiManager::isOpenNetwork(int networkIndex) {
+	return WiFi.encryptionType(networkIndex) == ENC_TYPE_NONE;
+}
+
+inline void SimpleWiFiManager::stationDisconnect() {
+	WiFi.stationDisconnect();
+}
+
+inline void SimpleWiFiManager::resetChip() {
+	ESP.reset();
+}
+
+inline void SimpleWiFiManager::startSSIDScan(const String& ssid) {
+	WiFi.scanNetworks(true, false, 0, (uint8_t*)ssid.c_str());
+}
+
+inline SimpleWiFiManager::ConnectFailure SimpleWiFiManager::stationFailure() {
+	switch (WiFi.stationConnectStatus()) {
+	case STATION_WRONG_PASSWORD:
+		return FailureWrongPassword;
+	case STATION_NO_AP_FOUND:
+		return FailureSSIDNotFound;
+	case STATION_CONNECT_FAIL:
+		return FailureOther;
+	default:
+		return FailureNone;
+	}
+}
+
+inline void SimpleWiFiManager::persistStationConfig(boolean persist) {
+	WiFi.persistent(persist);
+}
+
+inline void SimpleWiFiManager::commitStationConfig() {
+	WiFi.commitStationConfig();
+}
+
+inline void SimpleWiFiManager::clearStationBSSID() {
+	HostStationConfig conf = WiFi.currentConfig();
+	conf.bssidSet = false;
+	WiFi.setStationConfigCurrent(conf);
+}
+
+inline boolean SimpleWiFiManager::countryChannels(uint8_t& first, uint8_t& count) {
+	first = WiFi.countryStartChannel;
+	count = WiFi.countryChannels;
+	return true;
+}
+
+inline boolean SimpleWiFiManager::stationAssociated() {
+	return _staAssociated;
+}
+
+#ifdef WM_WPS
+inline boolean SimpleWiFiManager::wpsStart() {
+	return WiFi.wpsStart(&SimpleWiFiManager::wpsStatusCallback);
+}
+
+inline void SimpleWiFiManager::wpsStop() {
+	WiFi.wpsStop();
+}
+
+inline void SimpleWiFiManager::stationConnect() {
+	WiFi.stationConnect();
+}
+#endif
+#endif
+
 //start up config portal callback
 inline void SimpleWiFiManager::setAPCallback(void(*func)(SimpleWiFiManager* wiFiManager)) {
 	_apcallback = func;
 }
 
+#ifdef WM_WPS
+//if this is set, try WPS push-button setup when the saved credentials fail - default false
+inline void SimpleWiFiManager::setTryWPS(boolean tryWPS, unsigned long timeout) {
+	_tryWPS = tryWPS;
+	_wpsTimeout = timeout * 1000;
+}
+#endif
+
 //sets a custom element to add to head, like a new style tag
 inline void SimpleWiFiManager::setCustomHeadElement(const char* element) {
 	_customHeadElement = element;
+	invalidatePageCache();
+}
+
+//sets the channel of the config portal AP, 0 selects the least congested channel - default 0
+inline void SimpleWiFiManager::setAPChannel(uint8_t channel) {
+	_apChannelOverride = channel <= MAX_AP_CHANNEL ? channel : 0;
+}
+
+#ifndef WM_NO_UPDATE
+//if this is true, the portal offers a firmware upload at /update - default false
+inline void SimpleWiFiManager::setOTAUpdateEnabled(boolean enabled) {
+	_otaEnabled = enabled;
+	invalidatePageCache();
+}
+#endif
+
+//marks all cached pages as outdated
+inline void SimpleWiFiManager::invalidatePageCache() {
+	if (++_configGeneration == 0) { _configGeneration = 1; }
 }
 
 //if this is true, remove duplicated Access Points - defaut true
@@ -6,11 +6,31 @@
 #include <SimpleWiFiManager.h>         //https://github.com/tzapu/WiFiManager
 
 bool Connected = false;
-SimpleWiFiManager* wifiManager;
+SimpleWiFiManager* wifiManager = nullptr;
+//when to try again, after the portal timed out unused
+unsigned long retryAt = 0;
+
+void startConnecting() {
+    wifiManager = new SimpleWiFiManager();
+
+    //set custom ip for portal
+    //wifiManager->setAPStaticIPConfig(IPAddress(10,0,1,1), IPAddress(10,0,1,1), IPAddress(255,255,255,0));
+
+    //shut the portal down, if nobody used it for 10 minutes
+    wifiManager->setAPTimeout(600);
+
+    //fetches ssid and pass from eeprom and tries to connect
+    //if it does not connect it starts an access point with the specified name
+    //here  "AutoConnectAP"
+    wifiManager->autoConnect("AutoConnectAP");
+    //or use this for auto generated name ESP + ChipID
+    //wifiManager->autoConnect();
+}
 
 void setup() {
     // put your setup code here, to run once:
     Serial.begin(115200);
+    startConnecting();
 }
 
 void loop() {
@@ -18,27 +38,27 @@ void loop() {
         //Check if the wifi-status is still connected
         if(WiFi.status() != WL_CONNECTED){
             //wifi is not connected anymore, restart
-            wifiManager = new SimpleWiFiManager();
-
-            //set custom ip for portal
-            //wifiManager->setAPStaticIPConfig(IPAddress(10,0,1,1), IPAddress(10,0,1,1), IPAddress(255,255,255,0));
-
-            //fetches ssid and pass from eeprom and tries to connect
-            //if it does not connect it starts an access point with the specified name
-            //here  "AutoConnectAP"
-            Connected = wifiManager->autoConnect("AutoConnectAP"));
-            //or use this for auto generated name ESP + ChipID
-            //Connected = wifiManager->autoConnect();
+            Connected = false;
+            startConnecting();
         }
-    }else{
+    }else if(wifiManager != nullptr){
         //wifi is not connected, but is connecting
         if(wifiManager->HandleConnecting()){
-            //Connection was successful, clean up
-            Connected = true;
+            if(wifiManager->TimedOut()){
+                //nobody used the portal, try the saved network again in a minute
+                Serial.println("portal timed out");
+                retryAt = millis() + 60000;
+            }else{
+                //Connection was successful
+                Connected = true;
+                Serial.println("connected...yeey :)");
+            }
+            //clean up
             delete wifiManager;
             wifiManager = nullptr;
-            Serial.println("connected...yeey :)");
         }
+    }else if((long)(millis() - retryAt) >= 0){
+        startConnecting();
     }
     // put your main code here, to run repeatedly:
     delay(100);
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Compiles the AutoConnect example once with all features and once per WM_NO_* flag,
+# and reports how much flash, IRAM and static RAM each feature costs.
+# Needs arduino-cli with the esp8266 core installed, run it from the extras folder.
+#
+#   FQBN        board to compile for (default esp8266:esp8266:generic)
+#   SIZE_TOOL   size tool of the toolchain (default xtensa-lx106-elf-size)
+#   BASE_FLAGS  flags of every build (default -DNO_EXTRA_4K_HEAP, which WPS needs)
+
+FQBN=${FQBN:-esp8266:esp8266:generic}
+SIZE_TOOL=${SIZE_TOOL:-xtensa-lx106-elf-size}
+LIBRARY=$(cd .. && pwd)
+SKETCH="$LIBRARY/examples/AutoConnect"
+BUILD=${BUILD:-/tmp/SimpleWiFiManager-footprint}
+BASE_FLAGS=${BASE_FLAGS--DNO_EXTRA_4K_HEAP}
+
+FEATURES="WM_NO_INFO_PAGE WM_NO_NOSCAN_PAGE WM_NO_RESET_PAGE WM_NO_STATIC_IP_FIELDS WM_NO_LOCK_ICON WM_NO_WPS WM_NO_UPDATE"
+
+# prints "flash iram ram" of a build with the given compiler flags
+# It runs in a command substitution, so a failure only ends that subshell; callers use size_of.
+measure() {
+	out="$BUILD/$1"
+	arduino-cli compile --fqbn "$FQBN" --library "$LIBRARY" --build-property "compiler.cpp.extra_flags=$BASE_FLAGS $2" --output-dir "$out" "$SKETCH" > "$out.log" 2>&1 || {
+		echo "build $1 failed, see $out.log" >&2
+		return 1
+	}
+	"$SIZE_TOOL" -A "$out"/*.elf | awk '
+		$1 == ".irom0.text"                   { flash += $2 }
+		$1 == ".text" || $1 == ".text1"       { flash += $2; iram += $2 }
+		$1 == ".data" || $1 == ".rodata"      { flash += $2; ram += $2 }
+		$1 == ".bss"                          { ram += $2 }
+		END                                   { print flash, iram, ram }'
+}
+
+# sets SIZES to the output of measure, and stops the whole script if the build failed
+size_of() {
+	SIZES=$(measure "$1" "$2") || exit 1
+	case "$SIZES" in
+		*[0-9]" "*[0-9]" "*[0-9]) ;;
+		*) echo "could not read the size of build $1" >&2; exit 1 ;;
+	esac
+}
+
+mkdir -p "$BUILD"
+size_of all ""
+set -- $SIZES
+echo "all features: flash $1, IRAM $2, static RAM $3 bytes"
+ALL_FLASH=$1 ALL_IRAM=$2 ALL_RAM=$3
+
+printf "%-24s %8s %8s %8s\n" "feature" "flash" "IRAM" "RAM"
+ALL_FLAGS=""
+for feature in $FEATURES; do
+	ALL_FLAGS="$ALL_FLAGS -D$feature"
+	size_of "$feature" "-D$feature"
+	set -- $SIZES
+	printf "%-24s %8d %8d %8d\n" "$feature" $((ALL_FLASH - $1)) $((ALL_IRAM - $2)) $((ALL_RAM - $3))
+done
+
+size_of minimal "$ALL_FLAGS"
+set -- $SIZES
+printf "%-24s %8d %8d %8d\n" "all of them" $((ALL_FLASH - $1)) $((ALL_IRAM - $2)) $((ALL_RAM - $3))
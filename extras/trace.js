@@ -0,0 +1,121 @@
+'use strict';
+
+// Decodes a connect-process trace of a build with WM_TRACE and summarises its timing.
+// Takes the binary download of /trace or the text written by dumpTrace().
+//
+//   node trace.js [--timeline] trace.bin [other-trace.bin ...]
+//
+// Passing several traces prints their summaries one after another, to compare
+// the timing of field traces before and after a change.
+
+const fs = require('fs');
+
+const EVENTS = ['status', 'wifi', 'failure', 'scan', 'channel', 'route', 'redirect', 'servers', 'roam'];
+const STATUSES = ['Idle', 'ConnectingSaved', 'ConnectingWPS', 'HandlingAP', 'ConnectingAP', 'StartingAP'];
+const WIFI_STATUSES = { 0: 'IDLE', 1: 'NO_SSID_AVAIL', 2: 'SCAN_COMPLETED', 3: 'CONNECTED', 4: 'CONNECT_FAILED',
+  5: 'CONNECTION_LOST', 6: 'WRONG_PASSWORD', 7: 'DISCONNECTED', 255: 'NO_SHIELD' };
+const FAILURES = ['none', 'wrong password', 'SSID not found', 'DHCP timeout', 'timeout', 'other'];
+const ROUTES = ['/', '/wifi', '/0wifi', '/wifisave', '/i', '/r', '/update', '/update (done)', '/events', '/trace', 'not found'];
+
+function read(file) {
+  const data = fs.readFileSync(file);
+  if (data.length >= 4 && data.toString('latin1', 0, 3) === 'WMT') {
+    if (data[3] !== 1) {
+      throw new Error(file + ': unknown trace version ' + data[3]);
+    }
+    const entries = [];
+    for (let offset = 4; offset + 8 <= data.length; offset += 8) {
+      entries.push({
+        time: data.readUInt32LE(offset),
+        event: data[offset + 4],
+        value: data[offset + 5],
+        detail: data.readInt16LE(offset + 6)
+      });
+    }
+    return entries;
+  }
+  //text written by dumpTrace()
+  return data.toString('utf8').split(/\r?\n/).filter(line => /^\d+ \d+ \d+ -?\d+$/.test(line.trim())).map(line => {
+    const fields = line.trim().split(' ').map(Number);
+    return { time: fields[0], event: fields[1], value: fields[2], detail: fields[3] };
+  });
+}
+
+function describe(entry) {
+  switch (EVENTS[entry.event]) {
+    case 'status': return 'status ' + STATUSES[entry.value];
+    case 'wifi': return 'WiFi.status() ' + (WIFI_STATUSES[entry.value] || entry.value);
+    case 'failure': return 'connect failed: ' + FAILURES[entry.value];
+    case 'scan': return 'scan ' + entry.value + ' networks, best ' + entry.detail + ' dBm';
+    case 'channel': return 'AP channel ' + entry.value + ', score ' + entry.detail;
+    case 'route': return 'HTTP ' + ROUTES[entry.value];
+    case 'redirect': return 'captive portal redirect';
+    case 'servers': return entry.value ? 'portal servers started' : 'portal servers stopped';
+    case 'roam': return ['roaming to', 'roamed, now', 'roaming failed, now'][entry.value] + ' ' + entry.detail + ' dBm';
+    default: return 'unknown event ' + entry.event;
+  }
+}
+
+function summarise(file, entries, timeline) {
+  console.log(file + ': ' + entries.length + ' events');
+  if (entries.length === 0) {
+    return;
+  }
+  const start = entries[0].time;
+  const inStatus = {};
+  let requests = 0;
+  let scans = 0;
+  let current = null;
+  let since = start;
+  let connected = null;
+
+  for (const entry of entries) {
+    if (timeline) {
+      console.log('  +' + String(entry.time - start).padStart(8) + ' ms  ' + describe(entry));
+    }
+    switch (EVENTS[entry.event]) {
+      case 'status':
+        if (current !== null) {
+          inStatus[current] = (inStatus[current] || 0) + entry.time - since;
+        }
+        current = STATUSES[entry.value];
+        since = entry.time;
+        break;
+      case 'wifi':
+        if (entry.value === 3 && connected === null) {
+          connected = entry.time - start;
+        }
+        break;
+      case 'route':
+        requests++;
+        break;
+      case 'scan':
+        scans++;
+        break;
+    }
+  }
+  if (current !== null) {
+    inStatus[current] = (inStatus[current] || 0) + entries[entries.length - 1].time - since;
+  }
+
+  console.log('  duration        ' + (entries[entries.length - 1].time - start) + ' ms');
+  console.log('  connected       ' + (connected === null ? 'never' : 'after ' + connected + ' ms'));
+  console.log('  HTTP requests   ' + requests);
+  console.log('  scans           ' + scans);
+  for (const status of STATUSES) {
+    if (inStatus[status] !== undefined) {
+      console.log('  ' + status.padEnd(16) + inStatus[status] + ' ms');
+    }
+  }
+}
+
+const args = process.argv.slice(2);
+const timeline = args.includes('--timeline');
+const files = args.filter(arg => arg !== '--timeline');
+if (files.length === 0) {
+  console.log('usage: node trace.js [--timeline] trace.bin [other-trace.bin ...]');
+  process.exit(1);
+}
+for (const file of files) {
+  summarise(file, read(file), timeline);
+}
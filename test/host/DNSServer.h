@@ -0,0 +1,32 @@
+/**************************************************************
+   DNS server of the host backend, it only counts what the portal does with it
+ **************************************************************/
+
+#ifndef DNSServer_h
+#define DNSServer_h
+
+#include "WiFiManagerHost.h"
+
+enum class DNSReplyCode {
+	NoError = 0,
+	FormError = 1,
+	ServerFailure = 2,
+	NonExistentDomain = 3,
+	NotImplemented = 4,
+	Refused = 5
+};
+
+class DNSServer {
+  public:
+	~DNSServer() { stop(); }
+
+	void			setErrorReplyCode(const DNSReplyCode& replyCode) { (void)replyCode; }
+	bool			start(const uint16_t& port, const String& domainName, const IPAddress& resolvedIP);
+	void			stop();
+	void			processNextRequest();
+
+  private:
+	boolean			_running = false;
+};
+
+#endif
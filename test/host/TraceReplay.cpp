@@ -0,0 +1,217 @@
+/**************************************************************
+   Trace replay of the host backend, see TraceReplay.h
+ **************************************************************/
+
+#include "TraceReplay.h"
+#include <stdio.h>
+
+namespace host {
+	//the recorded ConnectFailure, when the station was associated but got no address
+	static const uint8_t FAILURE_DHCP_TIMEOUT = 3;
+	//the recorded ManagerStatus of autoConnect with saved credentials
+	static const int MANAGER_CONNECTING_SAVED = 1;
+	//how long before a recorded DHCP timeout the station associates at the latest
+	static const uint32_t ASSOCIATION_LEAD = 500;
+	//the route of the credentials form, it needs the fields
+	static const uint8_t ROUTE_WIFI_SAVE = 3;
+
+	//the requests behind the recorded routes, see SimpleWiFiManager::TraceRouteId
+	static const struct {
+		const char*		uri;
+		HTTPMethod		method;
+	} routes[] = {
+		{ "/", HTTP_GET },
+		{ "/wifi", HTTP_GET },
+		{ "/0wifi", HTTP_GET },
+		{ "/wifisave", HTTP_POST },
+		{ "/i", HTTP_GET },
+		{ "/r", HTTP_GET },
+		{ "/update", HTTP_GET },
+		//the finished upload is not replayed, the trace does not hold the firmware
+		{ NULL, HTTP_POST },
+		{ "/events", HTTP_GET },
+		{ "/trace", HTTP_GET },
+		{ "/generate_204", HTTP_GET }
+	};
+
+	bool parseTrace(const std::string& data, std::vector<TraceEntry>& entries) {
+		entries.clear();
+		if (data.size() >= 4 && data.compare(0, 3, "WMT") == 0) {
+			if (data[3] != 1) {
+				return false;
+			}
+			for (size_t offset = 4; offset + 8 <= data.size(); offset += 8) {
+				const uint8_t* bytes = (const uint8_t*)data.data() + offset;
+				TraceEntry entry;
+				entry.time = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+				entry.event = bytes[4];
+				entry.value = bytes[5];
+				entry.detail = (int16_t)(bytes[6] | bytes[7] << 8);
+				entries.push_back(entry);
+			}
+			return true;
+		}
+
+		//text of dumpTrace(), lines that are no entries are skipped like in extras/trace.js
+		size_t start = 0;
+		while (start < data.size()) {
+			size_t end = data.find('\n', start);
+			if (end == std::string::npos) {
+				end = data.size();
+			}
+			std::string line = data.substr(start, end - start);
+			start = end + 1;
+			unsigned long time;
+			unsigned event, value;
+			int detail;
+			int length = 0;
+			if (sscanf(line.c_str(), "%lu %u %u %d%n", &time, &event, &value, &detail, &length) != 4
+				|| line.find_first_not_of(" \r", length) != std::string::npos) {
+				continue;
+			}
+			TraceEntry entry;
+			entry.time = time;
+			entry.event = event;
+			entry.value = value;
+			entry.detail = detail;
+			entries.push_back(entry);
+		}
+		return !entries.empty();
+	}
+
+	bool TraceReplay::load(const std::string& data) {
+		if (!parseTrace(data, _entries)) {
+			return false;
+		}
+		buildSteps();
+		return true;
+	}
+
+	bool TraceReplay::loadFile(const char* path) {
+		FILE* file = fopen(path, "rb");
+		if (file == NULL) {
+			return false;
+		}
+		std::string data;
+		char buffer[512];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			data.append(buffer, read);
+		}
+		fclose(file);
+		return load(data);
+	}
+
+	int TraceReplay::firstStatus() const {
+		for (size_t i = 0; i < _entries.size(); i++) {
+			if (_entries[i].event == TraceStatus) {
+				return _entries[i].value;
+			}
+		}
+		return -1;
+	}
+
+	void TraceReplay::buildSteps() {
+		_steps.clear();
+		_nextStep = 0;
+		uint32_t networksTime = startTime();
+		for (size_t i = 0; i < _entries.size(); i++) {
+			const TraceEntry& entry = _entries[i];
+			Step step = { entry.time, Step::WiFiStatus, entry.value, entry.detail, false };
+			switch (entry.event) {
+			case TraceWiFiStatus:
+				_steps.push_back(step);
+				break;
+			case TraceConnectFailure:
+				if (entry.value == FAILURE_DHCP_TIMEOUT && i > 0) {
+					//the association itself is not recorded, it happened after the attempt started
+					step.kind = Step::Association;
+					step.time = std::max(_entries[i - 1].time, entry.time > ASSOCIATION_LEAD ? entry.time - ASSOCIATION_LEAD : 0);
+					_steps.push_back(step);
+				}
+				break;
+			case TraceScan:
+				//the networks are in range from the previous scan on, so the next scan finds them
+				step.kind = Step::Networks;
+				step.time = networksTime;
+				_steps.push_back(step);
+				networksTime = entry.time + 1;
+				break;
+			case TraceRoute:
+				if (entry.value >= sizeof(routes) / sizeof(routes[0]) || routes[entry.value].uri == NULL) {
+					break;
+				}
+				step.kind = Step::Route;
+				step.captiveRedirect = i + 1 < _entries.size() && _entries[i + 1].event == TraceCaptiveRedirect;
+				_steps.push_back(step);
+				break;
+			default:
+				//the other events are what the manager made of its inputs
+				break;
+			}
+		}
+		std::stable_sort(_steps.begin(), _steps.end(), [](const Step& a, const Step& b) { return a.time < b.time; });
+	}
+
+	void TraceReplay::begin() {
+		_nextStep = 0;
+		if (millis() < startTime()) {
+			advance(startTime() - millis());
+		}
+		WiFi.networks.clear();
+		WiFi.scriptStatus(WL_DISCONNECTED);
+		if (firstStatus() == MANAGER_CONNECTING_SAVED) {
+			WiFi.setSavedConfig("replay-0", "replay");
+		}
+		applyDue();
+	}
+
+	void TraceReplay::run(std::function<void()> handle, uint32_t tick, uint32_t linger) {
+		uint32_t end = endTime() + linger;
+		while (millis() <= end) {
+			applyDue();
+			handle();
+			//the replay only keeps the manager busy, the answers are not looked at
+			responses.clear();
+			advance(tick);
+		}
+	}
+
+	void TraceReplay::applyDue() {
+		while (_nextStep < _steps.size() && _steps[_nextStep].time <= millis()) {
+			apply(_steps[_nextStep++]);
+		}
+	}
+
+	void TraceReplay::apply(const Step& step) {
+		switch (step.kind) {
+		case Step::WiFiStatus:
+			WiFi.scriptStatus((wl_status_t)step.value);
+			break;
+		case Step::Association:
+			WiFi.scriptAssociation();
+			break;
+		case Step::Networks:
+			//only the count and the best RSSI are recorded
+			WiFi.networks.clear();
+			for (int i = 0; i < step.value; i++) {
+				WiFi.addNetwork(String("replay-") + String(i), String("replay"), 1 + (i % 3) * 5, step.detail - 5 * i);
+			}
+			break;
+		case Step::Route: {
+			Request request;
+			request.uri = routes[step.value].uri;
+			request.method = routes[step.value].method;
+			if (step.value == ROUTE_WIFI_SAVE) {
+				request.args.push_back(std::make_pair(String("s"), String("replay-0")));
+				request.args.push_back(std::make_pair(String("p"), String("replay")));
+			}
+			if (step.captiveRedirect) {
+				request.hostHeader = "connectivitycheck.example";
+			}
+			requests.push_back(request);
+			break;
+		}
+		}
+	}
+}
@@ -0,0 +1,83 @@
+/**************************************************************
+   Replays a trace recorded with WM_TRACE into the host backend.
+   The recorded WiFi status, scans and portal requests are fed to the simulated radio and
+   web server at their recorded times, so the manager can be run against a trace from the field
+   and its own trace compared with the recorded one.
+   Traces of ESP8266 devices are expected, the ESP32 numbers some WiFi status differently.
+ **************************************************************/
+
+#ifndef TraceReplay_h
+#define TraceReplay_h
+
+#include <WiFiManagerHost.h>
+
+namespace host {
+	//one event of the trace, like SimpleWiFiManager::TraceEntry
+	struct TraceEntry {
+		uint32_t		time;
+		uint8_t			event;
+		uint8_t			value;
+		int16_t			detail;
+	};
+
+	//the events and values of the trace format, see SimpleWiFiManager::TraceEvent
+	enum TraceEventId {
+		TraceStatus = 0,
+		TraceWiFiStatus = 1,
+		TraceConnectFailure = 2,
+		TraceScan = 3,
+		TraceAPChannel = 4,
+		TraceRoute = 5,
+		TraceCaptiveRedirect = 6,
+		TracePortalServers = 7,
+		TraceRoam = 8
+	};
+
+	//reads the binary download of /trace or the text of dumpTrace()
+	//Returns false, if the data is neither.
+	bool			parseTrace(const std::string& data, std::vector<TraceEntry>& entries);
+
+	class TraceReplay {
+	  public:
+		bool			load(const std::string& data);
+		bool			loadFile(const char* path);
+		const std::vector<TraceEntry>& entries() const { return _entries; }
+		uint32_t		startTime() const { return _entries.empty() ? 0 : _entries.front().time; }
+		uint32_t		endTime() const { return _entries.empty() ? 0 : _entries.back().time; }
+		//the first recorded status, it tells how the manager was started
+		int				firstStatus() const;
+
+		//puts the clock at the start of the trace and lets the script take over the radio
+		//The manager has to be started after this, credentials are saved, if it started with them.
+		void			begin();
+		//calls handle every tick milliseconds until the recorded time span plus linger is over,
+		//and feeds the recorded events in on the way
+		void			run(std::function<void()> handle, uint32_t tick = 10, uint32_t linger = 1000);
+
+	  private:
+		//an input of the trace for the simulation
+		struct Step {
+			enum Kind {
+				WiFiStatus,
+				Association,
+				Networks,
+				Route
+			};
+			uint32_t		time;
+			Kind			kind;
+			int				value;
+			int16_t			detail;
+			boolean			captiveRedirect;
+		};
+
+		void			buildSteps();
+		void			applyDue();
+		void			apply(const Step& step);
+
+		std::vector<TraceEntry> _entries;
+		std::vector<Step> _steps;
+		size_t			_nextStep = 0;
+	};
+}
+
+#endif
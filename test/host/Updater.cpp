@@ -0,0 +1,176 @@
+/**************************************************************
+   Updater of the host backend, see Updater.h
+ **************************************************************/
+
+#include "Updater.h"
+
+UpdaterClass Update;
+
+bool UpdaterClass::begin(size_t size, int command) {
+	(void)command;
+	if (_size > 0) {
+		//like the core, a running update has to be ended first
+		return false;
+	}
+	if (size == 0) {
+		_error = UPDATE_ERROR_SIZE;
+		return false;
+	}
+	if (size > ESP.getFreeSketchSpace()) {
+		_error = UPDATE_ERROR_SPACE;
+		return false;
+	}
+	_partition = fopen(partitionPath.c_str(), "w+b");
+	if (_partition == NULL) {
+		_error = UPDATE_ERROR_WRITE;
+		return false;
+	}
+	_error = UPDATE_ERROR_OK;
+	_expectedMD5 = String();
+	_size = size;
+	_written = 0;
+	return true;
+}
+
+bool UpdaterClass::setMD5(const char* expectedMD5) {
+	if (strlen(expectedMD5) != 32) {
+		return false;
+	}
+	_expectedMD5 = expectedMD5;
+	_expectedMD5.toLowerCase();
+	return true;
+}
+
+size_t UpdaterClass::write(uint8_t* data, size_t len) {
+	if (hasError() || !isRunning()) {
+		return 0;
+	}
+	if (_written + len > _size) {
+		_error = UPDATE_ERROR_SPACE;
+		return 0;
+	}
+	if (_written + len > failWriteAfter || fwrite(data, 1, len, _partition) != len) {
+		_error = UPDATE_ERROR_WRITE;
+		return 0;
+	}
+	_written += len;
+	return len;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining) {
+	if (_size == 0) {
+		return false;
+	}
+	if (hasError() || (_written < _size && !evenIfRemaining)) {
+		reset();
+		return false;
+	}
+
+	//verify what is in the partition, not what was passed to write
+	std::string image(_written, '\0');
+	fflush(_partition);
+	rewind(_partition);
+	if (fread(&image[0], 1, image.size(), _partition) != image.size()) {
+		_error = UPDATE_ERROR_WRITE;
+		reset();
+		return false;
+	}
+	if (_expectedMD5.length() != 0 && host::md5(image) != _expectedMD5) {
+		_error = UPDATE_ERROR_MD5;
+		reset();
+		return false;
+	}
+	bootImage = image;
+	reset();
+	return true;
+}
+
+void UpdaterClass::reset() {
+	if (_partition != NULL) {
+		fclose(_partition);
+		_partition = NULL;
+	}
+	_size = 0;
+	_written = 0;
+}
+
+/* MD5, RFC 1321 */
+
+namespace host {
+	static const uint32_t md5Sines[64] = {
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+		0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+		0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+		0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+		0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+		0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+	};
+	static const uint8_t md5Shifts[64] = {
+		7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+		5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+		4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+		6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+	};
+
+	String md5(const std::string& data) {
+		uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+		std::string message = data;
+		message += (char)0x80;
+		while (message.size() % 64 != 56) {
+			message += (char)0;
+		}
+		uint64_t bits = (uint64_t)data.size() * 8;
+		for (int i = 0; i < 8; i++) {
+			message += (char)(bits >> (8 * i));
+		}
+
+		for (size_t block = 0; block < message.size(); block += 64) {
+			uint32_t words[16];
+			for (int i = 0; i < 16; i++) {
+				const uint8_t* bytes = (const uint8_t*)message.data() + block + i * 4;
+				words[i] = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+			}
+			uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+			for (int i = 0; i < 64; i++) {
+				uint32_t f;
+				int g;
+				if (i < 16) {
+					f = (b & c) | (~b & d);
+					g = i;
+				}
+				else if (i < 32) {
+					f = (d & b) | (~d & c);
+					g = (5 * i + 1) % 16;
+				}
+				else if (i < 48) {
+					f = b ^ c ^ d;
+					g = (3 * i + 5) % 16;
+				}
+				else {
+					f = c ^ (b | ~d);
+					g = (7 * i) % 16;
+				}
+				uint32_t rotated = a + f + md5Sines[i] + words[g];
+				a = d;
+				d = c;
+				c = b;
+				b = b + (rotated << md5Shifts[i] | rotated >> (32 - md5Shifts[i]));
+			}
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+		}
+
+		String digest;
+		for (int i = 0; i < 16; i++) {
+			uint8_t value = state[i / 4] >> (8 * (i % 4));
+			digest += "0123456789abcdef"[value >> 4];
+			digest += "0123456789abcdef"[value & 0xF];
+		}
+		return digest;
+	}
+}
@@ -0,0 +1,55 @@
+/**************************************************************
+   Updater of the host backend, the OTA partition is a file.
+   It follows the ESP8266 core: the image is verified against the MD5 by end(),
+   and begin() refuses to start while an update is running.
+ **************************************************************/
+
+#ifndef Updater_h
+#define Updater_h
+
+#include "WiFiManagerHost.h"
+#include <stdio.h>
+
+#define U_FLASH 0
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_MD5 7
+
+class UpdaterClass {
+  public:
+	bool			begin(size_t size, int command = U_FLASH);
+	bool			setMD5(const char* expectedMD5);
+	size_t			write(uint8_t* data, size_t len);
+	bool			end(bool evenIfRemaining = false);
+	bool			isRunning() { return _size > 0; }
+	bool			hasError() { return _error != UPDATE_ERROR_OK; }
+	uint8_t			getError() { return _error; }
+
+	//simulation
+	//the file backing the OTA partition
+	std::string		partitionPath = "ota_partition.bin";
+	//writes fail with UPDATE_ERROR_WRITE, once this many bytes were written
+	size_t			failWriteAfter = SIZE_MAX;
+	//the image end() verified and marked for boot, read back from the partition
+	std::string		bootImage;
+
+  private:
+	void			reset();
+
+	FILE*			_partition = NULL;
+	size_t			_size = 0;
+	size_t			_written = 0;
+	uint8_t			_error = UPDATE_ERROR_OK;
+	String			_expectedMD5;
+};
+extern UpdaterClass Update;
+
+namespace host {
+	//MD5 of data as 32 lower case hex digits
+	String			md5(const std::string& data);
+}
+
+#endif
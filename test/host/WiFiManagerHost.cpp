@@ -0,0 +1,770 @@
+/**************************************************************
+   Host backend of SimpleWiFiManager, see WiFiManagerHost.h
+ **************************************************************/
+
+#include "WiFiManagerHost.h"
+#include <DNSServer.h>
+#include <Updater.h>
+#include <stdio.h>
+
+HostSerial Serial;
+EspClass ESP;
+HostWiFiClass WiFi;
+
+namespace host {
+	std::deque<Request> requests;
+	std::deque<Response> responses;
+	int dnsServers = 0;
+	unsigned dnsRequests = 0;
+
+	static unsigned long now = 0;
+	static uint32_t randomState = 1;
+
+	void reset() {
+		now = 0;
+		randomState = 1;
+		Serial.enabled = getenv("WM_HOST_DEBUG") != NULL;
+		ESP = EspClass();
+		WiFi = HostWiFiClass();
+		if (Update.isRunning()) {
+			Update.end();
+		}
+		Update = UpdaterClass();
+		requests.clear();
+		responses.clear();
+		dnsServers = 0;
+		dnsRequests = 0;
+	}
+
+	void advance(uint32_t ms) {
+		for (uint32_t i = 0; i < ms; i++) {
+			now++;
+			WiFi.update();
+		}
+	}
+
+	uint32_t random() {
+		randomState = randomState * 1103515245 + 12345;
+		return randomState;
+	}
+
+	String Response::header(const String& name) const {
+		for (size_t i = 0; i < headers.size(); i++) {
+			if (headers[i].first == name) {
+				return headers[i].second;
+			}
+		}
+		return String();
+	}
+}
+
+unsigned long millis() {
+	return host::now;
+}
+
+void delay(unsigned long ms) {
+	host::advance(ms);
+}
+
+void yield() {
+}
+
+/* String */
+
+std::string String::digits(unsigned long value, unsigned char base) {
+	if (base < 2 || base > 16) {
+		base = DEC;
+	}
+	std::string result;
+	do {
+		result.insert(result.begin(), "0123456789abcdef"[value % base]);
+		value /= base;
+	} while (value != 0);
+	return result;
+}
+
+std::string String::signedDigits(long value, unsigned char base) {
+	if (value < 0 && base == DEC) {
+		return "-" + digits(-(unsigned long)value, base);
+	}
+	return digits((unsigned long)value, base);
+}
+
+void String::replace(const String& find, const String& replace) {
+	if (find._buffer.empty()) {
+		return;
+	}
+	size_t position = 0;
+	while ((position = _buffer.find(find._buffer, position)) != std::string::npos) {
+		_buffer.replace(position, find._buffer.size(), replace._buffer);
+		position += replace._buffer.size();
+	}
+}
+
+void String::toLowerCase() {
+	for (size_t i = 0; i < _buffer.size(); i++) {
+		if (_buffer[i] >= 'A' && _buffer[i] <= 'Z') {
+			_buffer[i] += 'a' - 'A';
+		}
+	}
+}
+
+/* Print */
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+	size_t written = 0;
+	while (size--) {
+		written += write(*buffer++);
+	}
+	return written;
+}
+
+size_t HostSerial::write(uint8_t c) {
+	if (enabled) {
+		fputc(c, stdout);
+	}
+	return 1;
+}
+
+/* IPAddress */
+
+bool IPAddress::fromString(const char* address) {
+	unsigned int parts[4];
+	char rest;
+	if (sscanf(address, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &rest) != 4) {
+		return false;
+	}
+	for (int i = 0; i < 4; i++) {
+		if (parts[i] > 255) {
+			return false;
+		}
+	}
+	*this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+	return true;
+}
+
+String IPAddress::toString() const {
+	String result;
+	for (int i = 0; i < 4; i++) {
+		if (i != 0) {
+			result += '.';
+		}
+		result += (unsigned int)((_address >> (8 * i)) & 0xFF);
+	}
+	return result;
+}
+
+/* WiFi */
+
+bool HostWiFiClass::mode(WiFiMode_t mode) {
+	if ((_mode & WIFI_STA) && !(mode & WIFI_STA)) {
+		if (_network >= 0) {
+			leaveNetwork(WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+		}
+		_connecting = false;
+		_connectStatus = STATION_IDLE;
+	}
+	if ((_mode & WIFI_AP) && !(mode & WIFI_AP)) {
+		_apStations = 0;
+	}
+	_mode = mode;
+	return true;
+}
+
+wl_status_t HostWiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid, bool connect) {
+	(void)channel;
+	mode((WiFiMode_t)(_mode | WIFI_STA));
+	_config.ssid = ssid;
+	_config.psk = passphrase != NULL ? passphrase : "";
+	_config.bssidSet = bssid != NULL;
+	if (bssid != NULL) {
+		memcpy(_config.bssid, bssid, sizeof(_config.bssid));
+	}
+	if (_persistent) {
+		_saved = _config;
+	}
+	if (connect) {
+		startConnect();
+	}
+	return status();
+}
+
+wl_status_t HostWiFiClass::begin() {
+	mode((WiFiMode_t)(_mode | WIFI_STA));
+	startConnect();
+	return status();
+}
+
+bool HostWiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet) {
+	(void)gateway;
+	(void)subnet;
+	_staticIP = localIP;
+	return true;
+}
+
+bool HostWiFiClass::disconnect(bool wifioff) {
+	//like the core, this clears the station config, and with persistent also the one in flash
+	_config = HostStationConfig();
+	if (_persistent) {
+		_saved = _config;
+	}
+	stationDisconnect();
+	if (wifioff) {
+		mode((WiFiMode_t)(_mode & ~WIFI_STA));
+	}
+	return true;
+}
+
+bool HostWiFiClass::reconnect() {
+	if (!(_mode & WIFI_STA)) {
+		return false;
+	}
+	stationDisconnect();
+	startConnect();
+	return true;
+}
+
+wl_status_t HostWiFiClass::status() {
+	if (!(_mode & WIFI_STA)) {
+		return WL_DISCONNECTED;
+	}
+	if (_scripted) {
+		return _scriptedStatus;
+	}
+	switch (_connectStatus) {
+	case STATION_IDLE:
+		return WL_IDLE_STATUS;
+	case STATION_WRONG_PASSWORD:
+		return WL_WRONG_PASSWORD;
+	case STATION_NO_AP_FOUND:
+		return WL_NO_SSID_AVAIL;
+	case STATION_CONNECT_FAIL:
+		return WL_CONNECT_FAILED;
+	case STATION_GOT_IP:
+		return WL_CONNECTED;
+	default:
+		return WL_DISCONNECTED;
+	}
+}
+
+station_status_t HostWiFiClass::stationConnectStatus() {
+	if (!_scripted) {
+		return _connectStatus;
+	}
+	switch (_scriptedStatus) {
+	case WL_IDLE_STATUS:
+		return STATION_IDLE;
+	case WL_NO_SSID_AVAIL:
+		return STATION_NO_AP_FOUND;
+	case WL_CONNECTED:
+		return STATION_GOT_IP;
+	case WL_CONNECT_FAILED:
+		return STATION_CONNECT_FAIL;
+	case WL_WRONG_PASSWORD:
+		return STATION_WRONG_PASSWORD;
+	default:
+		return STATION_CONNECTING;
+	}
+}
+
+void HostWiFiClass::stationDisconnect() {
+	if (_network >= 0) {
+		leaveNetwork(WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+	}
+	_connecting = false;
+	_connectStatus = STATION_IDLE;
+}
+
+IPAddress HostWiFiClass::localIP() {
+	if (stationConnectStatus() != STATION_GOT_IP) {
+		return IPAddress();
+	}
+	return _staticIP ? _staticIP : IPAddress(192, 168, 1, 100);
+}
+
+uint8_t* HostWiFiClass::BSSID() {
+	static uint8_t none[6] = {};
+	return _network >= 0 ? networks[_network].bssid : none;
+}
+
+String HostWiFiClass::BSSIDstr() {
+	char text[18];
+	const uint8_t* bssid = BSSID();
+	snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+	return String(text);
+}
+
+int32_t HostWiFiClass::RSSI() {
+	return _network >= 0 ? networks[_network].rssi : 31;
+}
+
+int32_t HostWiFiClass::channel() {
+	if (_network >= 0) {
+		return networks[_network].channel;
+	}
+	return 1;
+}
+
+int8_t HostWiFiClass::scanNetworks(bool async, bool showHidden, uint8_t channel, uint8_t* ssid) {
+	(void)showHidden;
+	(void)channel;
+	mode((WiFiMode_t)(_mode | WIFI_STA));
+	std::vector<HostNetwork> results;
+	for (size_t i = 0; i < networks.size(); i++) {
+		if (ssid == NULL || networks[i].ssid == String((const char*)ssid)) {
+			results.push_back(networks[i]);
+		}
+	}
+	_scanComplete = false;
+	_scanResults = results;
+	if (async) {
+		asyncScans++;
+		_scanRunning = true;
+		_scanDone = millis() + scanTime;
+		return WIFI_SCAN_RUNNING;
+	}
+	//a synchronous scan blocks the caller for the whole scan
+	syncScans++;
+	host::advance(scanTime);
+	_scanComplete = true;
+	return _scanResults.size();
+}
+
+int8_t HostWiFiClass::scanComplete() {
+	if (_scanRunning) {
+		return WIFI_SCAN_RUNNING;
+	}
+	if (_scanComplete) {
+		return _scanResults.size();
+	}
+	return WIFI_SCAN_FAILED;
+}
+
+void HostWiFiClass::scanDelete() {
+	_scanResults.clear();
+	_scanComplete = false;
+}
+
+String HostWiFiClass::SSID(uint8_t networkItem) {
+	return networkItem < _scanResults.size() ? _scanResults[networkItem].ssid : String();
+}
+
+uint8_t HostWiFiClass::encryptionType(uint8_t networkItem) {
+	if (networkItem >= _scanResults.size()) {
+		return 0xFF;
+	}
+	return _scanResults[networkItem].psk.length() == 0 ? ENC_TYPE_NONE : ENC_TYPE_CCMP;
+}
+
+int32_t HostWiFiClass::RSSI(uint8_t networkItem) {
+	return networkItem < _scanResults.size() ? _scanResults[networkItem].rssi : 0;
+}
+
+uint8_t* HostWiFiClass::BSSID(uint8_t networkItem) {
+	return networkItem < _scanResults.size() ? _scanResults[networkItem].bssid : NULL;
+}
+
+String HostWiFiClass::BSSIDstr(uint8_t networkItem) {
+	char text[18];
+	const uint8_t* bssid = BSSID(networkItem);
+	if (bssid == NULL) {
+		return String();
+	}
+	snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+	return String(text);
+}
+
+int32_t HostWiFiClass::channel(uint8_t networkItem) {
+	return networkItem < _scanResults.size() ? _scanResults[networkItem].channel : 0;
+}
+
+bool HostWiFiClass::softAP(const char* ssid, const char* passphrase, int channel, int ssidHidden, int maxConnection) {
+	(void)ssid;
+	(void)passphrase;
+	(void)ssidHidden;
+	(void)maxConnection;
+	//an associated station keeps the radio on its channel
+	switchAPChannel(_network >= 0 ? networks[_network].channel : channel);
+	mode((WiFiMode_t)(_mode | WIFI_AP));
+	return true;
+}
+
+void HostWiFiClass::switchAPChannel(int32_t channel) {
+	if (channel == _apChannel) {
+		return;
+	}
+	_apChannel = channel;
+	if (_mode & WIFI_AP) {
+		apChannelSwitches++;
+		_apStations = 0;
+	}
+}
+
+bool HostWiFiClass::softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet) {
+	(void)gateway;
+	(void)subnet;
+	_apIP = localIP;
+	return true;
+}
+
+bool HostWiFiClass::softAPdisconnect(bool wifioff) {
+	if (wifioff) {
+		mode((WiFiMode_t)(_mode & ~WIFI_AP));
+	}
+	_apStations = 0;
+	return true;
+}
+
+size_t HostWiFiClass::addNetwork(const String& ssid, const String& psk, int32_t channel, int32_t rssi, boolean dhcp) {
+	HostNetwork network;
+	network.ssid = ssid;
+	network.psk = psk;
+	const uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, (uint8_t)(networks.size() + 1) };
+	memcpy(network.bssid, bssid, sizeof(bssid));
+	network.channel = channel;
+	network.rssi = rssi;
+	network.dhcp = dhcp;
+	networks.push_back(network);
+	return networks.size() - 1;
+}
+
+void HostWiFiClass::setSavedConfig(const String& ssid, const String& psk) {
+	_saved = HostStationConfig();
+	_saved.ssid = ssid;
+	_saved.psk = psk;
+	_config = _saved;
+}
+
+void HostWiFiClass::stationJoinsAP() {
+	if (!(_mode & WIFI_AP)) {
+		return;
+	}
+	_apStations++;
+	WiFiEventSoftAPModeStationConnected event = {};
+	event.aid = _apStations;
+	_apStationHandlers.fire(event);
+}
+
+void HostWiFiClass::stationLeavesAP() {
+	if (_apStations > 0) {
+		_apStations--;
+	}
+}
+
+void HostWiFiClass::dropLink() {
+	if (_network < 0) {
+		return;
+	}
+	leaveNetwork(WIFI_DISCONNECT_REASON_BEACON_TIMEOUT);
+	startConnect();
+}
+
+bool HostWiFiClass::wpsStart(wps_st_cb_t callback) {
+	if (!(_mode & WIFI_STA) || _connecting) {
+		return false;
+	}
+	_wpsCallback = callback;
+	_wpsDone = millis() + wpsTime;
+	return true;
+}
+
+void HostWiFiClass::scriptStatus(wl_status_t status) {
+	if (!_scripted) {
+		_scripted = true;
+		if (_network >= 0) {
+			leaveNetwork(WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+		}
+		_connecting = false;
+	}
+	if (status != WL_CONNECTED && _scriptedStatus == WL_CONNECTED) {
+		WiFiEventStationModeDisconnected event = {};
+		event.ssid = _config.ssid;
+		event.reason = WIFI_DISCONNECT_REASON_BEACON_TIMEOUT;
+		_disconnectedHandlers.fire(event);
+	}
+	_scriptedStatus = status;
+}
+
+void HostWiFiClass::scriptAssociation() {
+	WiFiEventStationModeConnected event = {};
+	event.ssid = _config.ssid;
+	event.channel = 1;
+	_connectedHandlers.fire(event);
+}
+
+void HostWiFiClass::startConnect() {
+	if (_scripted) {
+		//the script decides, what the connect leads to
+		return;
+	}
+	if (_network >= 0) {
+		leaveNetwork(WIFI_DISCONNECT_REASON_ASSOC_LEAVE);
+	}
+	_connecting = true;
+	_connectStatus = STATION_CONNECTING;
+	_nextStep = millis() + connectTime;
+}
+
+void HostWiFiClass::leaveNetwork(WiFiDisconnectReason reason) {
+	WiFiEventStationModeDisconnected event;
+	event.ssid = _config.ssid;
+	memcpy(event.bssid, BSSID(), sizeof(event.bssid));
+	event.reason = reason;
+	_network = -1;
+	_connectStatus = STATION_CONNECTING;
+	_disconnectedHandlers.fire(event);
+}
+
+int HostWiFiClass::findNetwork() {
+	int found = -1;
+	for (size_t i = 0; i < networks.size(); i++) {
+		if (networks[i].ssid != _config.ssid) {
+			continue;
+		}
+		if (_config.bssidSet && memcmp(networks[i].bssid, _config.bssid, sizeof(_config.bssid)) != 0) {
+			continue;
+		}
+		//the SDK picks the strongest BSSID of the SSID
+		if (found == -1 || networks[i].rssi > networks[found].rssi) {
+			found = i;
+		}
+	}
+	return found;
+}
+
+void HostWiFiClass::update() {
+	uint32_t now = millis();
+	if (_scanRunning && now >= _scanDone) {
+		_scanRunning = false;
+		_scanComplete = true;
+	}
+
+	if (_wpsCallback != NULL && wpsButtonPressed && now >= _wpsDone) {
+		wps_st_cb_t callback = _wpsCallback;
+		_wpsCallback = NULL;
+		if (wpsResult == WPS_CB_ST_SUCCESS) {
+			//like the SDK, the received credentials become the station config
+			_config = HostStationConfig();
+			_config.ssid = wpsSSID;
+			_config.psk = wpsPsk;
+			if (_persistent) {
+				_saved = _config;
+			}
+		}
+		callback(wpsResult);
+	}
+
+	if (!(_mode & WIFI_STA) || !_connecting || now < _nextStep) {
+		return;
+	}
+	if (_network >= 0) {
+		//associated, the DHCP lease arrives
+		_connecting = false;
+		_connectStatus = STATION_GOT_IP;
+		return;
+	}
+
+	//the SDK keeps retrying until it is told to stop
+	_nextStep = now + connectTime;
+	int found = findNetwork();
+	WiFiEventStationModeDisconnected failed;
+	failed.ssid = _config.ssid;
+	memset(failed.bssid, 0, sizeof(failed.bssid));
+	if (found < 0) {
+		_connectStatus = STATION_NO_AP_FOUND;
+		failed.reason = WIFI_DISCONNECT_REASON_NO_AP_FOUND;
+		_disconnectedHandlers.fire(failed);
+		return;
+	}
+	if (networks[found].psk != _config.psk) {
+		_connectStatus = STATION_WRONG_PASSWORD;
+		failed.reason = WIFI_DISCONNECT_REASON_AUTH_FAIL;
+		_disconnectedHandlers.fire(failed);
+		return;
+	}
+
+	_network = found;
+	//there is only one radio, the AP has to follow the station
+	switchAPChannel(networks[found].channel);
+	_connectStatus = STATION_CONNECTING;
+	_nextStep = networks[found].dhcp ? now + dhcpTime : UINT32_MAX;
+	WiFiEventStationModeConnected connected;
+	connected.ssid = networks[found].ssid;
+	memcpy(connected.bssid, networks[found].bssid, sizeof(connected.bssid));
+	connected.channel = networks[found].channel;
+	_connectedHandlers.fire(connected);
+}
+
+/* web server */
+
+void WiFiClient::stop() {
+	if (_connection) {
+		_connection->open = false;
+	}
+	_connection.reset();
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+	if (!connected()) {
+		return 0;
+	}
+	_connection->received.append((const char*)buffer, size);
+	return size;
+}
+
+void HostWebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler) {
+	Route route;
+	route.uri = uri;
+	route.method = method;
+	route.handler = handler;
+	route.uploadHandler = uploadHandler;
+	_routes.push_back(route);
+}
+
+void HostWebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+	_headerKeys.clear();
+	for (size_t i = 0; i < headerKeysCount; i++) {
+		_headerKeys.push_back(headerKeys[i]);
+	}
+}
+
+String HostWebServer::arg(const String& name) {
+	for (size_t i = 0; i < _request.args.size(); i++) {
+		if (_request.args[i].first == name) {
+			return _request.args[i].second;
+		}
+	}
+	return String();
+}
+
+String HostWebServer::header(const String& name) {
+	//like the core, only collected headers are kept
+	if (std::find(_headerKeys.begin(), _headerKeys.end(), name) == _headerKeys.end()) {
+		return String();
+	}
+	for (size_t i = 0; i < _request.headers.size(); i++) {
+		if (_request.headers[i].first == name) {
+			return _request.headers[i].second;
+		}
+	}
+	return String();
+}
+
+void HostWebServer::sendHeader(const String& name, const String& value, bool first) {
+	if (first) {
+		_response.headers.insert(_response.headers.begin(), std::make_pair(name, value));
+	}
+	else {
+		_response.headers.push_back(std::make_pair(name, value));
+	}
+}
+
+void HostWebServer::send(int code, const String& contentType, const String& content) {
+	_response.code = code;
+	_response.contentType = contentType;
+	_response.content = content;
+	String head = String("HTTP/1.1 ") + String(code) + "\r\n";
+	_currentClient.print(head);
+	_currentClient.print(content);
+}
+
+void HostWebServer::handleClient() {
+	if (!_begun || host::requests.empty()) {
+		return;
+	}
+	_request = host::requests.front();
+	host::requests.pop_front();
+
+	std::shared_ptr<HostConnection> connection = std::make_shared<HostConnection>();
+	_currentClient = WiFiClient(connection);
+	_response = host::Response();
+	_response.connection = connection;
+	_contentLength = 0;
+
+	const Route* route = NULL;
+	for (size_t i = 0; i < _routes.size(); i++) {
+		if (_routes[i].uri == _request.uri && (_routes[i].method == HTTP_ANY || _routes[i].method == _request.method)) {
+			route = &_routes[i];
+			break;
+		}
+	}
+	boolean handled = true;
+	if (route == NULL) {
+		if (_notFoundHandler) {
+			_notFoundHandler();
+		}
+		else {
+			send(404);
+		}
+	}
+	else {
+		if (route->uploadHandler && _request.method == HTTP_POST && _request.filePart) {
+			_upload.reset(new HTTPUpload());
+			runUpload(*route);
+			handled = _upload->status != UPLOAD_FILE_ABORTED;
+		}
+		if (handled) {
+			route->handler();
+		}
+		_upload.reset();
+	}
+	host::responses.push_back(_response);
+	//the handler may keep the client open, like the status stream does
+	_currentClient = WiFiClient();
+}
+
+HTTPUpload& HostWebServer::upload() {
+	if (!_upload) {
+		//the cores dereference a null pointer here
+		fprintf(stderr, "upload() called without a running upload\n");
+		abort();
+	}
+	return *_upload;
+}
+
+void HostWebServer::runUpload(const Route& route) {
+	_upload->filename = "firmware.bin";
+	_upload->totalSize = 0;
+	_upload->currentSize = 0;
+	_upload->status = UPLOAD_FILE_START;
+	route.uploadHandler();
+
+	size_t length = std::min(_request.upload.size(), _request.abortUploadAfter);
+	for (size_t offset = 0; offset < length; offset += HTTP_UPLOAD_BUFLEN) {
+		_upload->status = UPLOAD_FILE_WRITE;
+		_upload->currentSize = std::min((size_t)HTTP_UPLOAD_BUFLEN, length - offset);
+		memcpy(_upload->buf, _request.upload.data() + offset, _upload->currentSize);
+		_upload->totalSize += _upload->currentSize;
+		route.uploadHandler();
+	}
+
+	_upload->currentSize = 0;
+	_upload->status = length < _request.upload.size() ? UPLOAD_FILE_ABORTED : UPLOAD_FILE_END;
+	route.uploadHandler();
+}
+
+/* DNS server */
+
+bool DNSServer::start(const uint16_t& port, const String& domainName, const IPAddress& resolvedIP) {
+	(void)port;
+	(void)domainName;
+	(void)resolvedIP;
+	if (!_running) {
+		_running = true;
+		host::dnsServers++;
+	}
+	return true;
+}
+
+void DNSServer::stop() {
+	if (_running) {
+		_running = false;
+		host::dnsServers--;
+	}
+}
+
+void DNSServer::processNextRequest() {
+	if (_running) {
+		host::dnsRequests++;
+	}
+}
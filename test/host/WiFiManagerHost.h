@@ -0,0 +1,575 @@
+/**************************************************************
+   Host backend of SimpleWiFiManager, selected with -DWM_HOST.
+   It stands in for the Arduino core, the WiFi radio, the web server and the clock,
+   so the library can be built and driven by the unit tests in test/ on the build machine.
+   Only the parts of the ESP8266 core the library uses are simulated.
+ **************************************************************/
+
+#ifndef WiFiManagerHost_h
+#define WiFiManagerHost_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+//program memory is ordinary memory on the host
+#define PROGMEM
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper*>(pstr_pointer))
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#define DEC 10
+#define HEX 16
+
+class String {
+  public:
+	String() {}
+	String(const char* cstr) : _buffer(cstr != NULL ? cstr : "") {}
+	String(const __FlashStringHelper* pstr) : _buffer(pstr != NULL ? (const char*)pstr : "") {}
+	String(const std::string& str) : _buffer(str) {}
+	String(char c) : _buffer(1, c) {}
+	String(unsigned char value, unsigned char base = DEC) : _buffer(digits(value, base)) {}
+	String(int value, unsigned char base = DEC) : _buffer(signedDigits(value, base)) {}
+	String(unsigned int value, unsigned char base = DEC) : _buffer(digits(value, base)) {}
+	String(long value, unsigned char base = DEC) : _buffer(signedDigits(value, base)) {}
+	String(unsigned long value, unsigned char base = DEC) : _buffer(digits(value, base)) {}
+
+	unsigned int	length() const { return _buffer.size(); }
+	const char*		c_str() const { return _buffer.c_str(); }
+	const std::string& str() const { return _buffer; }
+	char			charAt(unsigned int index) const { return index < _buffer.size() ? _buffer[index] : 0; }
+	void			replace(const String& find, const String& replace);
+	void			toLowerCase();
+
+	//Arduino Strings are only false, when they hold no text
+	explicit operator bool() const { return !_buffer.empty(); }
+
+	String&			operator+=(const String& rhs) { _buffer += rhs._buffer; return *this; }
+	String&			operator+=(const char* rhs) { _buffer += rhs; return *this; }
+	String&			operator+=(const __FlashStringHelper* rhs) { _buffer += (const char*)rhs; return *this; }
+	String&			operator+=(char c) { _buffer += c; return *this; }
+	String&			operator+=(unsigned char value) { return *this += String(value); }
+	String&			operator+=(int value) { return *this += String(value); }
+	String&			operator+=(unsigned int value) { return *this += String(value); }
+	String&			operator+=(long value) { return *this += String(value); }
+	String&			operator+=(unsigned long value) { return *this += String(value); }
+
+  private:
+	static std::string	digits(unsigned long value, unsigned char base);
+	static std::string	signedDigits(long value, unsigned char base);
+
+	std::string		_buffer;
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String result = lhs; result += rhs; return result; }
+inline bool operator==(const String& lhs, const String& rhs) { return lhs.str() == rhs.str(); }
+inline bool operator!=(const String& lhs, const String& rhs) { return lhs.str() != rhs.str(); }
+
+class Print;
+
+class Printable {
+  public:
+	virtual ~Printable() {}
+	virtual size_t	printTo(Print& p) const = 0;
+};
+
+class Print {
+  public:
+	virtual ~Print() {}
+	virtual size_t	write(uint8_t c) = 0;
+	virtual size_t	write(const uint8_t* buffer, size_t size);
+
+	size_t			print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+	size_t			print(const char* s) { return print(String(s)); }
+	size_t			print(const __FlashStringHelper* s) { return print(String(s)); }
+	size_t			print(char c) { return write((uint8_t)c); }
+	size_t			print(unsigned char value, int base = DEC) { return print(String(value, base)); }
+	size_t			print(int value, int base = DEC) { return print(String(value, base)); }
+	size_t			print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+	size_t			print(long value, int base = DEC) { return print(String(value, base)); }
+	size_t			print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+	size_t			print(const Printable& p) { return p.printTo(*this); }
+
+	size_t			println() { return print("\r\n"); }
+	template <typename T>
+	size_t			println(const T& value) { size_t n = print(value); return n + println(); }
+};
+
+//the Serial of the host, silent unless enabled
+class HostSerial : public Print {
+  public:
+	void			begin(unsigned long) {}
+	size_t			write(uint8_t c) override;
+	using Print::write;
+
+	boolean			enabled = false;
+};
+extern HostSerial Serial;
+
+class IPAddress : public Printable {
+  public:
+	IPAddress() : _address(0) {}
+	IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+		: _address(first | second << 8 | third << 16 | (uint32_t)fourth << 24) {}
+	IPAddress(uint32_t address) : _address(address) {}
+
+	operator uint32_t() const { return _address; }
+	bool			fromString(const char* address);
+	String			toString() const;
+	size_t			printTo(Print& p) const override { return p.print(toString()); }
+
+  private:
+	uint32_t		_address;
+};
+
+//the clock only moves, when a test lets time pass
+unsigned long millis();
+void delay(unsigned long ms);
+void yield();
+
+class EspClass {
+  public:
+	uint32_t		getChipId() { return 0x00C0FFEE; }
+	uint32_t		getFlashChipId() { return 0x1640EF; }
+	uint32_t		getFlashChipSize() { return 4 * 1024 * 1024; }
+	uint32_t		getFlashChipRealSize() { return 4 * 1024 * 1024; }
+	uint32_t		getFreeHeap() { return freeHeap; }
+	uint32_t		getFreeSketchSpace() { return freeSketchSpace; }
+	void			reset() { resets++; }
+	void			restart() { restarts++; }
+
+	//simulation
+	uint32_t		freeHeap = 40000;
+	uint32_t		freeSketchSpace = 1024 * 1024;
+	unsigned		resets = 0;
+	unsigned		restarts = 0;
+};
+extern EspClass ESP;
+
+//WiFi types of the ESP8266 core
+enum WiFiMode {
+	WIFI_OFF = 0,
+	WIFI_STA = 1,
+	WIFI_AP = 2,
+	WIFI_AP_STA = 3
+};
+typedef WiFiMode WiFiMode_t;
+
+typedef enum {
+	WL_NO_SHIELD = 255,
+	WL_IDLE_STATUS = 0,
+	WL_NO_SSID_AVAIL = 1,
+	WL_SCAN_COMPLETED = 2,
+	WL_CONNECTED = 3,
+	WL_CONNECT_FAILED = 4,
+	WL_CONNECTION_LOST = 5,
+	WL_WRONG_PASSWORD = 6,
+	WL_DISCONNECTED = 7
+} wl_status_t;
+
+enum wl_enc_type {
+	ENC_TYPE_TKIP = 2,
+	ENC_TYPE_CCMP = 4,
+	ENC_TYPE_NONE = 7
+};
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+//connect status of the SDK, wifi_station_get_connect_status()
+enum station_status_t {
+	STATION_IDLE = 0,
+	STATION_CONNECTING,
+	STATION_WRONG_PASSWORD,
+	STATION_NO_AP_FOUND,
+	STATION_CONNECT_FAIL,
+	STATION_GOT_IP
+};
+
+enum WiFiDisconnectReason {
+	WIFI_DISCONNECT_REASON_UNSPECIFIED = 1,
+	WIFI_DISCONNECT_REASON_ASSOC_LEAVE = 8,
+	WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+	WIFI_DISCONNECT_REASON_BEACON_TIMEOUT = 200,
+	WIFI_DISCONNECT_REASON_NO_AP_FOUND = 201,
+	WIFI_DISCONNECT_REASON_AUTH_FAIL = 202
+};
+
+struct WiFiEventStationModeConnected {
+	String			ssid;
+	uint8_t			bssid[6];
+	uint8_t			channel;
+};
+
+struct WiFiEventStationModeDisconnected {
+	String			ssid;
+	uint8_t			bssid[6];
+	WiFiDisconnectReason reason;
+};
+
+//WPS results of the SDK callback
+enum wps_cb_status {
+	WPS_CB_ST_SUCCESS = 0,
+	WPS_CB_ST_FAILED,
+	WPS_CB_ST_TIMEOUT,
+	WPS_CB_ST_WEP,
+	WPS_CB_ST_UNK
+};
+typedef void (*wps_st_cb_t)(int status);
+
+struct WiFiEventSoftAPModeStationConnected {
+	uint8_t			mac[6];
+	uint8_t			aid;
+};
+
+//the handler stays registered as long as the returned pointer is kept
+struct WiFiEventHandlerOpaque {
+	virtual ~WiFiEventHandlerOpaque() {}
+};
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+template <typename Event>
+class HostEventHandlers {
+  public:
+	WiFiEventHandler add(std::function<void(const Event&)> callback);
+	void			fire(const Event& event);
+
+  private:
+	struct Handler : WiFiEventHandlerOpaque {
+		std::function<void(const Event&)> callback;
+	};
+	std::vector<std::weak_ptr<Handler>> _handlers;
+};
+
+template <typename Event>
+WiFiEventHandler HostEventHandlers<Event>::add(std::function<void(const Event&)> callback) {
+	std::shared_ptr<Handler> handler = std::make_shared<Handler>();
+	handler->callback = callback;
+	_handlers.push_back(handler);
+	return handler;
+}
+
+template <typename Event>
+void HostEventHandlers<Event>::fire(const Event& event) {
+	//a handler may drop itself or others while being called
+	std::vector<std::weak_ptr<Handler>> handlers = _handlers;
+	for (size_t i = 0; i < handlers.size(); i++) {
+		std::shared_ptr<Handler> handler = handlers[i].lock();
+		if (handler) {
+			handler->callback(event);
+		}
+	}
+}
+
+//a network the simulated radio can see and join
+struct HostNetwork {
+	String			ssid;
+	//empty for an open network
+	String			psk;
+	uint8_t			bssid[6];
+	int32_t			channel;
+	int32_t			rssi;
+	//false, if it never hands out an address
+	boolean			dhcp;
+};
+
+//the station settings, like the SDK's struct station_config
+struct HostStationConfig {
+	String			ssid;
+	String			psk;
+	boolean			bssidSet = false;
+	uint8_t			bssid[6] = {};
+};
+
+//the radio of the host, with the API of the ESP8266 core's WiFi object
+class HostWiFiClass {
+  public:
+	bool			mode(WiFiMode_t mode);
+	WiFiMode_t		getMode() { return _mode; }
+	void			persistent(bool persistent) { _persistent = persistent; }
+	wl_status_t		begin(const char* ssid, const char* passphrase = NULL, int32_t channel = 0, const uint8_t* bssid = NULL, bool connect = true);
+	wl_status_t		begin();
+	bool			config(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+	bool			disconnect(bool wifioff = false);
+	bool			reconnect();
+	bool			isConnected() { return status() == WL_CONNECTED; }
+	wl_status_t		status();
+
+	IPAddress		localIP();
+	String			macAddress() { return String("5C:CF:7F:00:00:01"); }
+	String			SSID() const { return _config.ssid; }
+	String			psk() const { return _config.psk; }
+	uint8_t*		BSSID();
+	String			BSSIDstr();
+	int32_t			RSSI();
+	int32_t			channel();
+
+	int8_t			scanNetworks(bool async = false, bool showHidden = false, uint8_t channel = 0, uint8_t* ssid = NULL);
+	int8_t			scanComplete();
+	void			scanDelete();
+	String			SSID(uint8_t networkItem);
+	uint8_t			encryptionType(uint8_t networkItem);
+	int32_t			RSSI(uint8_t networkItem);
+	uint8_t*		BSSID(uint8_t networkItem);
+	String			BSSIDstr(uint8_t networkItem);
+	int32_t			channel(uint8_t networkItem);
+
+	bool			softAP(const char* ssid, const char* passphrase = NULL, int channel = 1, int ssidHidden = 0, int maxConnection = 4);
+	bool			softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+	bool			softAPdisconnect(bool wifioff = false);
+	uint8_t			softAPgetStationNum() { return _apStations; }
+	IPAddress		softAPIP() { return _apIP; }
+	//the channel of the AP, it follows the channel of the station like on the chip
+	int32_t			softAPchannel() { return _apChannel; }
+	String			softAPmacAddress() { return String("5E:CF:7F:00:00:01"); }
+
+	WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)> callback) { return _connectedHandlers.add(callback); }
+	WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected&)> callback) { return _disconnectedHandlers.add(callback); }
+	WiFiEventHandler onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected&)> callback) { return _apStationHandlers.add(callback); }
+
+	//SDK calls of the ESP8266 platform helpers
+	station_status_t stationConnectStatus();
+	void			stationDisconnect();
+	void			commitStationConfig() { _saved = _config; }
+	//like wifi_station_set_config_current, it does not touch the connection
+	void			setStationConfigCurrent(const HostStationConfig& config) { _config = config; }
+	void			stationConnect() { startConnect(); }
+	bool			wpsStart(wps_st_cb_t callback);
+	void			wpsStop() { _wpsCallback = NULL; }
+
+	//simulation
+	//the networks in range
+	std::vector<HostNetwork> networks;
+	uint32_t		connectTime = 1000;
+	uint32_t		dhcpTime = 500;
+	uint32_t		scanTime = 2000;
+	unsigned		syncScans = 0;
+	unsigned		asyncScans = 0;
+	//AP channel changes while the AP was up, each one drops the stations of the AP
+	unsigned		apChannelSwitches = 0;
+	//the channels of the configured country like wifi_get_country(), the SDK defaults to 1-13
+	uint8_t			countryStartChannel = 1;
+	uint8_t			countryChannels = 13;
+	//the router of the WPS button, it answers wpsTime after WPS started, if the button was pressed
+	boolean			wpsButtonPressed = false;
+	uint32_t		wpsTime = 3000;
+	int				wpsResult = WPS_CB_ST_SUCCESS;
+	String			wpsSSID;
+	String			wpsPsk;
+
+	//adds a network in range and returns its index
+	size_t			addNetwork(const String& ssid, const String& psk, int32_t channel, int32_t rssi, boolean dhcp = true);
+	//credentials stored in flash, as after a reboot
+	void			setSavedConfig(const String& ssid, const String& psk);
+	const HostStationConfig& savedConfig() const { return _saved; }
+	const HostStationConfig& currentConfig() const { return _config; }
+	boolean			stationAssociated() const { return _network >= 0; }
+	void			stationJoinsAP();
+	void			stationLeavesAP();
+	//the network the station is associated with goes out of range, the SDK starts to reconnect
+	void			dropLink();
+	//called by the clock on every simulated millisecond
+	void			update();
+	//From now on, the status is only changed by the script and not by the simulated connect, used by host::TraceReplay.
+	void			scriptStatus(wl_status_t status);
+	//the station associates under the script, without getting an address
+	void			scriptAssociation();
+
+  private:
+	void			startConnect();
+	void			leaveNetwork(WiFiDisconnectReason reason);
+	int				findNetwork();
+	void			switchAPChannel(int32_t channel);
+
+	WiFiMode_t		_mode = WIFI_OFF;
+	boolean			_persistent = true;
+	HostStationConfig _saved;
+	HostStationConfig _config;
+
+	//station
+	boolean			_connecting = false;
+	station_status_t _connectStatus = STATION_IDLE;
+	uint32_t		_nextStep = 0;
+	int				_network = -1;
+	IPAddress		_staticIP;
+
+	//scan
+	boolean			_scanRunning = false;
+	boolean			_scanComplete = false;
+	uint32_t		_scanDone = 0;
+	std::vector<HostNetwork> _scanResults;
+
+	//script
+	boolean			_scripted = false;
+	wl_status_t		_scriptedStatus = WL_DISCONNECTED;
+
+	//WPS
+	wps_st_cb_t		_wpsCallback = NULL;
+	uint32_t		_wpsDone = 0;
+
+	//soft AP
+	IPAddress		_apIP = IPAddress(192, 168, 4, 1);
+	uint8_t			_apStations = 0;
+	int32_t			_apChannel = 1;
+
+	HostEventHandlers<WiFiEventStationModeConnected> _connectedHandlers;
+	HostEventHandlers<WiFiEventStationModeDisconnected> _disconnectedHandlers;
+	HostEventHandlers<WiFiEventSoftAPModeStationConnected> _apStationHandlers;
+};
+extern HostWiFiClass WiFi;
+
+//one TCP connection of the simulated web server, what is written to it is kept for the tests
+struct HostConnection {
+	boolean			open = true;
+	std::string		received;
+};
+
+class WiFiClient : public Print {
+  public:
+	WiFiClient() {}
+	explicit WiFiClient(std::shared_ptr<HostConnection> connection) : _connection(connection) {}
+
+	uint8_t			connected() { return _connection && _connection->open; }
+	void			stop();
+	void			setNoDelay(bool) {}
+	IPAddress		localIP() { return WiFi.softAPIP(); }
+	size_t			write(uint8_t c) override { return write(&c, 1); }
+	size_t			write(const uint8_t* buffer, size_t size) override;
+	using Print::write;
+
+  private:
+	std::shared_ptr<HostConnection> _connection;
+};
+
+enum HTTPMethod {
+	HTTP_ANY,
+	HTTP_GET,
+	HTTP_POST
+};
+
+enum HTTPUploadStatus {
+	UPLOAD_FILE_START,
+	UPLOAD_FILE_WRITE,
+	UPLOAD_FILE_END,
+	UPLOAD_FILE_ABORTED
+};
+
+#define HTTP_UPLOAD_BUFLEN 2048
+
+struct HTTPUpload {
+	HTTPUploadStatus status;
+	String			filename;
+	size_t			totalSize;
+	size_t			currentSize;
+	uint8_t			buf[HTTP_UPLOAD_BUFLEN];
+};
+
+namespace host {
+	struct Request {
+		HTTPMethod		method = HTTP_GET;
+		String			uri = "/";
+		String			hostHeader = "192.168.4.1";
+		std::vector<std::pair<String, String>> args;
+		std::vector<std::pair<String, String>> headers;
+		//body of a file upload
+		std::string		upload;
+		//false for a POST without a file part, the upload handler is not called then
+		boolean			filePart = true;
+		//the client goes away after this many bytes of the upload
+		size_t			abortUploadAfter = SIZE_MAX;
+	};
+
+	struct Response {
+		int				code = 0;
+		String			contentType;
+		String			content;
+		std::vector<std::pair<String, String>> headers;
+		//stays open, if the handler kept the client
+		std::shared_ptr<HostConnection> connection;
+
+		String			header(const String& name) const;
+	};
+
+	//requests wait here until the portal's web server handles them, one per handleClient()
+	extern std::deque<Request> requests;
+	//answered requests, oldest first
+	extern std::deque<Response> responses;
+	//running DNS servers and the requests they answered
+	extern int dnsServers;
+	extern unsigned dnsRequests;
+
+	//sets the clock and all simulated hardware back to power-on
+	void			reset();
+	//lets the simulated time pass, the radio reacts on the way
+	void			advance(uint32_t ms);
+	uint32_t		random();
+}
+
+//the web server of the host, it answers the requests queued in host::requests
+class HostWebServer {
+  public:
+	typedef std::function<void(void)> THandlerFunction;
+
+	HostWebServer(int port) : _port(port) {}
+
+	void			begin() { _begun = true; }
+	void			handleClient();
+	void			on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+	void			on(const String& uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, THandlerFunction()); }
+	void			on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler);
+	void			onNotFound(THandlerFunction handler) { _notFoundHandler = handler; }
+	void			collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+
+	String			uri() { return _request.uri; }
+	HTTPMethod		method() { return _request.method; }
+	String			arg(const String& name);
+	String			arg(int i) { return i < args() ? _request.args[i].second : String(); }
+	String			argName(int i) { return i < args() ? _request.args[i].first : String(); }
+	int				args() { return _request.args.size(); }
+	String			header(const String& name);
+	String			hostHeader() { return _request.hostHeader; }
+	WiFiClient&		client() { return _currentClient; }
+	//like the cores, there is only an upload while a file is received
+	HTTPUpload&		upload();
+
+	void			sendHeader(const String& name, const String& value, bool first = false);
+	void			setContentLength(size_t contentLength) { _contentLength = contentLength; }
+	void			send(int code, const String& contentType = String(), const String& content = String());
+
+  private:
+	struct Route {
+		String			uri;
+		HTTPMethod		method;
+		THandlerFunction handler;
+		THandlerFunction uploadHandler;
+	};
+
+	void			runUpload(const Route& route);
+
+	int				_port;
+	boolean			_begun = false;
+	std::vector<Route> _routes;
+	THandlerFunction _notFoundHandler;
+	std::vector<String> _headerKeys;
+
+	host::Request	_request;
+	host::Response	_response;
+	WiFiClient		_currentClient;
+	std::unique_ptr<HTTPUpload> _upload;
+	size_t			_contentLength = 0;
+};
+
+#endif
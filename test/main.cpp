@@ -0,0 +1,79 @@
+/**************************************************************
+   Runs the host unit tests of SimpleWiFiManager
+ **************************************************************/
+
+#include "test.h"
+
+static TestCase* firstTest = NULL;
+static TestCase** lastTest = &firstTest;
+unsigned testFailures = 0;
+
+TestRegistrar::TestRegistrar(TestCase* testCase) {
+	*lastTest = testCase;
+	lastTest = &testCase->next;
+}
+
+boolean runFor(SimpleWiFiManager& manager, uint32_t ms, uint32_t tick) {
+	unsigned long end = millis() + ms;
+	while (millis() < end) {
+		if (manager.HandleConnecting()) {
+			return true;
+		}
+		host::advance(tick);
+	}
+	return false;
+}
+
+boolean waitForPortal(SimpleWiFiManager& manager, uint32_t ms) {
+	unsigned long end = millis() + ms;
+	while (!(WiFi.getMode() & WIFI_AP)) {
+		if (millis() >= end) {
+			return false;
+		}
+		manager.HandleConnecting();
+		host::advance(10);
+	}
+	return true;
+}
+
+host::Response request(SimpleWiFiManager& manager, const host::Request& request) {
+	host::requests.push_back(request);
+	manager.HandleConnecting();
+	if (host::responses.empty()) {
+		host::requests.clear();
+		return host::Response();
+	}
+	host::Response response = host::responses.front();
+	host::responses.pop_front();
+	return response;
+}
+
+host::Response get(SimpleWiFiManager& manager, const char* uri) {
+	host::Request getRequest;
+	getRequest.uri = uri;
+	return request(manager, getRequest);
+}
+
+int main(int argc, char** argv) {
+	unsigned run = 0;
+	unsigned failed = 0;
+	for (TestCase* testCase = firstTest; testCase != NULL; testCase = testCase->next) {
+		//a test name as argument runs only that test
+		if (argc > 1 && strcmp(argv[1], testCase->name) != 0) {
+			continue;
+		}
+		host::reset();
+		unsigned failuresBefore = testFailures;
+		testCase->function();
+		run++;
+		if (testFailures != failuresBefore) {
+			failed++;
+			printf("FAIL %s\n", testCase->name);
+		}
+		else {
+			printf("ok   %s\n", testCase->name);
+		}
+	}
+	printf("%u tests, %u failed\n", run, failed);
+	return failed == 0 && run != 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+/**************************************************************
+   Replays a recorded trace into the host backend and writes the trace of the replayed run,
+   e.g. to compare the timing of a change against a trace from the field:
+
+     make -C test replay
+     test/build/replay trace.bin > replayed.txt
+     node extras/trace.js trace.bin replayed.txt
+ **************************************************************/
+
+#include <SimpleWiFiManager.h>
+#include <TraceReplay.h>
+#include <stdio.h>
+
+//writes to stdout
+class StdoutPrint : public Print {
+  public:
+	size_t			write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+	using Print::write;
+};
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s trace.bin|trace.txt\n", argv[0]);
+		return 2;
+	}
+	host::reset();
+	host::TraceReplay replay;
+	if (!replay.loadFile(argv[1])) {
+		fprintf(stderr, "%s: no trace\n", argv[1]);
+		return 1;
+	}
+
+	replay.begin();
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	//start the manager the way the recorded one was started, see SimpleWiFiManager::ManagerStatus
+	switch (replay.firstStatus()) {
+	case 1:
+		manager.autoConnect("replay");
+		break;
+#ifdef WM_WPS
+	case 2:
+		manager.setTryWPS(true);
+		manager.autoConnect("replay");
+		break;
+#endif
+	default:
+		manager.startConfigPortal("replay");
+		break;
+	}
+	replay.run([&manager]() { manager.HandleConnecting(); });
+
+	StdoutPrint output;
+	manager.dumpTrace(output);
+	return 0;
+}
@@ -0,0 +1,73 @@
+/**************************************************************
+   Minimal test harness of the host unit tests.
+   Every TEST registers itself, test/main.cpp runs them one after another on a fresh host backend.
+ **************************************************************/
+
+#ifndef SimpleWiFiManager_test_h
+#define SimpleWiFiManager_test_h
+
+#include <SimpleWiFiManager.h>
+#include <stdio.h>
+
+typedef void (*TestFunction)();
+
+struct TestCase {
+	const char*		name;
+	TestFunction	function;
+	TestCase*		next;
+};
+
+//registers a test, before main runs
+struct TestRegistrar {
+	TestRegistrar(TestCase* testCase);
+};
+
+extern unsigned testFailures;
+
+#define TEST(name) \
+	static void name(); \
+	static TestCase name##_case = { #name, name, NULL }; \
+	static TestRegistrar name##_registrar(&name##_case); \
+	static void name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			testFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQ(expected, actual) \
+	do { \
+		long long expectedValue = (expected); \
+		long long actualValue = (actual); \
+		if (expectedValue != actualValue) { \
+			printf("  %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, expectedValue, actualValue); \
+			testFailures++; \
+		} \
+	} while (0)
+
+//calls HandleConnecting every tick milliseconds, until it returns true or the time is up
+//Returns true, if HandleConnecting returned true.
+boolean runFor(SimpleWiFiManager& manager, uint32_t ms, uint32_t tick = 10);
+
+//calls HandleConnecting, until the AP of the portal is up
+//Returns false, if it did not start within ms.
+boolean waitForPortal(SimpleWiFiManager& manager, uint32_t ms = 10000);
+
+//queues a request for the portal, lets the manager answer it and returns the response
+//The response has code 0, if the portal did not answer.
+host::Response request(SimpleWiFiManager& manager, const host::Request& request);
+host::Response get(SimpleWiFiManager& manager, const char* uri);
+
+//collects printed text, e.g. of dumpTrace
+class StringPrint : public Print {
+  public:
+	size_t			write(uint8_t c) override { text += (char)c; return 1; }
+	using Print::write;
+
+	String			text;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/**************************************************************
+   Channel selection of the portal AP
+ **************************************************************/
+
+#include "test.h"
+
+TEST(apChannelIsSelectedWithoutBlocking) {
+	WiFi.addNetwork("one", "secret", 1, -40);
+	WiFi.addNetwork("six", "secret", 6, -40);
+	WiFi.addNetwork("eleven", "secret", 11, -80);
+	//North America, 12 and 13 would be the least congested
+	WiFi.countryChannels = 11;
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	unsigned long start = millis();
+	manager.startConfigPortal("portal");
+	//the scan runs in the background, the AP is started by HandleConnecting
+	CHECK_EQ(start, millis());
+	CHECK_EQ(0, WiFi.syncScans);
+	CHECK(!(WiFi.getMode() & WIFI_AP));
+	CHECK(manager.IsConnecting());
+
+	CHECK(waitForPortal(manager));
+	CHECK_EQ(11, manager.getAPChannel());
+	CHECK(manager.getAPChannelScore() > 0);
+	//the results are freed
+	CHECK_EQ(WIFI_SCAN_FAILED, WiFi.scanComplete());
+}
+
+TEST(apChannelUsesAllChannelsOfCountry) {
+	WiFi.addNetwork("one", "secret", 1, -40);
+	WiFi.addNetwork("six", "secret", 6, -40);
+	WiFi.addNetwork("eleven", "secret", 11, -40);
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	CHECK_EQ(13, manager.getAPChannel());
+}
+
+TEST(unknownCountryKeepsToCommonChannels) {
+	WiFi.addNetwork("one", "secret", 1, -40);
+	WiFi.addNetwork("eleven", "secret", 11, -40);
+	WiFi.countryChannels = 0;
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	CHECK_EQ(6, manager.getAPChannel());
+}
+
+TEST(oldScanResultsAreNotReused) {
+	WiFi.addNetwork("old", "secret", 13, -40);
+	WiFi.scanNetworks();
+	//the neighbourhood changed since that scan
+	WiFi.networks.clear();
+	WiFi.addNetwork("new", "secret", 1, -40);
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	CHECK_EQ(6, manager.getAPChannel());
+}
+
+TEST(fixedApChannelNeedsNoScan) {
+	WiFi.addNetwork("three", "secret", 3, -40);
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.setAPChannel(3);
+	manager.startConfigPortal("portal");
+	CHECK(WiFi.getMode() & WIFI_AP);
+	CHECK_EQ(3, manager.getAPChannel());
+	CHECK_EQ(0, WiFi.asyncScans);
+	CHECK_EQ(0, WiFi.syncScans);
+}
@@ -0,0 +1,155 @@
+/**************************************************************
+   Connect-process against the simulated radio
+ **************************************************************/
+
+#include "test.h"
+
+TEST(savedCredentialsConnect) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.setSavedConfig("home", "secret");
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	CHECK(manager.autoConnect("portal"));
+	CHECK(manager.IsConnecting());
+	CHECK(runFor(manager, 3000));
+	CHECK(WiFi.isConnected());
+	CHECK(!manager.IsConnecting());
+	CHECK_EQ(WIFI_STA, WiFi.getMode());
+}
+
+TEST(wrongSavedPasswordStartsPortal) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.setSavedConfig("home", "wrong");
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.autoConnect("portal");
+	CHECK(!runFor(manager, 6000));
+	CHECK(waitForPortal(manager));
+	CHECK(manager.IsConnecting());
+	CHECK(WiFi.getMode() & WIFI_AP);
+	CHECK_EQ(200, get(manager, "/").code);
+}
+
+TEST(newCredentialsAreOnlyStoredOnSuccess) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.setSavedConfig("old", "old-secret");
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+
+	host::Request save;
+	save.uri = "/wifisave";
+	save.args.push_back(std::make_pair(String("s"), String("home")));
+	save.args.push_back(std::make_pair(String("p"), String("wrong")));
+	CHECK_EQ(200, request(manager, save).code);
+	//the AP stays up while the new credentials are tried
+	CHECK(!runFor(manager, 10000));
+	CHECK(manager.IsConnecting());
+	CHECK(WiFi.getMode() & WIFI_AP);
+	CHECK(WiFi.savedConfig().ssid == "old");
+
+	save.args[1].second = "secret";
+	request(manager, save);
+	CHECK(runFor(manager, 5000));
+	CHECK(WiFi.isConnected());
+	CHECK(WiFi.savedConfig().ssid == "home");
+	CHECK(WiFi.savedConfig().psk == "secret");
+}
+
+//tries the credentials through the portal, and returns what the status stream reported
+static std::string tryCredentials(SimpleWiFiManager& manager, boolean dropLinkWhileAssociated) {
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	waitForPortal(manager);
+	host::Response events = get(manager, "/events");
+
+	host::Request save;
+	save.uri = "/wifisave";
+	save.args.push_back(std::make_pair(String("s"), String("home")));
+	save.args.push_back(std::make_pair(String("p"), String("secret")));
+	request(manager, save);
+	//associated, but no address
+	runFor(manager, 3500);
+	CHECK(WiFi.stationAssociated());
+	if (dropLinkWhileAssociated) {
+		//the network leaves for good, the station can not find it again
+		WiFi.networks[0].ssid = "elsewhere";
+		WiFi.dropLink();
+	}
+	runFor(manager, 6000);
+	return events.connection->received;
+}
+
+TEST(associatedWithoutAddressIsDHCPTimeout) {
+	WiFi.addNetwork("home", "secret", 6, -60, false);
+	SimpleWiFiManager manager;
+	std::string events = tryCredentials(manager, false);
+	CHECK(events.find("DHCP timeout") != std::string::npos);
+}
+
+TEST(lostAssociationIsNoDHCPTimeout) {
+	WiFi.addNetwork("home", "secret", 6, -60, false);
+	SimpleWiFiManager manager;
+	std::string events = tryCredentials(manager, true);
+	CHECK(events.find("DHCP timeout") == std::string::npos);
+	CHECK(events.find("SSID not found") != std::string::npos);
+}
+
+TEST(apMovesToRouterChannelBeforeTrial) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.addNetwork("neighbour", "other", 1, -70);
+	WiFi.addNetwork("other", "other", 11, -70);
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	CHECK(WiFi.softAPchannel() != 6);
+	WiFi.stationJoinsAP();
+	//the config page scans, the trial uses its results
+	CHECK_EQ(200, get(manager, "/wifi").code);
+
+	host::Request save;
+	save.uri = "/wifisave";
+	save.args.push_back(std::make_pair(String("s"), String("home")));
+	save.args.push_back(std::make_pair(String("p"), String("secret")));
+	request(manager, save);
+	CHECK(!runFor(manager, 2100));
+	//moved before the station associates
+	CHECK(!WiFi.stationAssociated());
+	CHECK_EQ(6, WiFi.softAPchannel());
+	CHECK_EQ(6, manager.getAPChannel());
+	unsigned switches = WiFi.apChannelSwitches;
+
+	CHECK(runFor(manager, 5000));
+	//the association did not move the AP again
+	CHECK_EQ(switches, WiFi.apChannelSwitches);
+}
+
+TEST(newSubscriberGetsLastResult) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+
+	host::Request save;
+	save.uri = "/wifisave";
+	save.args.push_back(std::make_pair(String("s"), String("home")));
+	save.args.push_back(std::make_pair(String("p"), String("wrong")));
+	request(manager, save);
+	CHECK(!runFor(manager, 10000));
+	//subscribed after the attempt failed, e.g. the client lost the AP meanwhile
+	host::Response events = get(manager, "/events");
+	CHECK(events.connection->received.find("wrong password") != std::string::npos);
+
+	//a new attempt forgets the old result
+	request(manager, save);
+	runFor(manager, 100);
+	events = get(manager, "/events");
+	CHECK(events.connection->received.find("wrong password") == std::string::npos);
+}
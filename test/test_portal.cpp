@@ -0,0 +1,73 @@
+/**************************************************************
+   Pages of the config portal
+ **************************************************************/
+
+#include "test.h"
+
+TEST(rootPageIsRevalidated) {
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+
+	host::Response first = get(manager, "/");
+	CHECK_EQ(200, first.code);
+	String etag = first.header("ETag");
+	CHECK(etag.length() != 0);
+
+	host::Request revalidate;
+	revalidate.headers.push_back(std::make_pair(String("If-None-Match"), etag));
+	CHECK_EQ(304, request(manager, revalidate).code);
+
+	//a changed setting shows on the page, so the old ETag must not match anymore
+	manager.setCustomHeadElement("<style></style>");
+	host::Response changed = request(manager, revalidate);
+	CHECK_EQ(200, changed.code);
+	CHECK(changed.header("ETag") != etag);
+}
+
+TEST(foreignHostIsRedirected) {
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+
+	host::Request check;
+	check.uri = "/generate_204";
+	check.hostHeader = "connectivitycheck.gstatic.com";
+	host::Response response = request(manager, check);
+	CHECK_EQ(302, response.code);
+	CHECK(response.header("Location") == "http://192.168.4.1");
+}
+
+TEST(unusedPortalTimesOut) {
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.setAPTimeout(60);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	CHECK(!manager.TimedOut());
+
+	CHECK(runFor(manager, 65000, 100));
+	CHECK(manager.TimedOut());
+	CHECK(!manager.IsConnecting());
+	CHECK(!WiFi.isConnected());
+	CHECK(!(WiFi.getMode() & WIFI_AP));
+
+	//a new connect-process starts without the old timeout
+	manager.startConfigPortal("portal");
+	CHECK(!manager.TimedOut());
+}
+
+TEST(connectIsNoTimeout) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.setSavedConfig("home", "secret");
+
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.setAPTimeout(60);
+	manager.autoConnect("portal");
+	CHECK(runFor(manager, 3000));
+	CHECK(WiFi.isConnected());
+	CHECK(!manager.TimedOut());
+}
@@ -0,0 +1,76 @@
+/**************************************************************
+   Link-quality monitor and roaming between the BSSIDs of an SSID
+ **************************************************************/
+
+#include "test.h"
+
+//connects to the only AP of home, which then gets weak while a stronger one appears
+static void connectToFadingAP(SimpleWiFiManager& manager) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.setSavedConfig("home", "secret");
+	manager.setDebugOutput(false);
+	manager.setRoaming(true);
+	manager.autoConnect("portal");
+	CHECK(runFor(manager, 3000));
+	CHECK(WiFi.isConnected());
+
+	WiFi.networks[0].rssi = -85;
+	WiFi.addNetwork("home", "secret", 11, -55);
+}
+
+//calls HandleLinkQuality every tick milliseconds
+static void monitorFor(SimpleWiFiManager& manager, uint32_t ms, uint32_t tick = 100) {
+	unsigned long end = millis() + ms;
+	while (millis() < end) {
+		manager.HandleLinkQuality();
+		host::advance(tick);
+	}
+}
+
+TEST(roamUnpinsBSSID) {
+	SimpleWiFiManager manager;
+	connectToFadingAP(manager);
+	unsigned disconnects = 0;
+	WiFiEventHandler counter = WiFi.onStationModeDisconnected([&disconnects](const WiFiEventStationModeDisconnected&) {
+		disconnects++;
+	});
+
+	//the call that finishes the roam drops the pin, it must not drop the new link with it
+	unsigned long end = millis() + 30000;
+	while (millis() < end) {
+		uint16_t roams = manager.getRoamCount();
+		unsigned disconnectsBefore = disconnects;
+		manager.HandleLinkQuality();
+		if (manager.getRoamCount() != roams) {
+			CHECK_EQ(disconnectsBefore, disconnects);
+		}
+		host::advance(100);
+	}
+	CHECK_EQ(1, manager.getRoamCount());
+	CHECK(WiFi.isConnected());
+	CHECK(memcmp(WiFi.BSSID(), WiFi.networks[1].bssid, 6) == 0);
+	CHECK(!WiFi.currentConfig().bssidSet);
+	CHECK(!WiFi.savedConfig().bssidSet);
+}
+
+TEST(roamTimeoutUnpinsBSSID) {
+	SimpleWiFiManager manager;
+	connectToFadingAP(manager);
+
+	//the weak link is sampled for the whole history, then the scan finds the stronger AP
+	unsigned long end = millis() + 30000;
+	while (millis() < end && WiFi.currentConfig().bssidSet == false) {
+		manager.HandleLinkQuality();
+		host::advance(100);
+	}
+	CHECK(WiFi.currentConfig().bssidSet);
+	//and it is gone, before the station gets there
+	WiFi.networks.pop_back();
+
+	monitorFor(manager, 10000);
+	CHECK_EQ(0, manager.getRoamCount());
+	CHECK(!WiFi.currentConfig().bssidSet);
+	//back at the weak AP, which is the only one left
+	CHECK(WiFi.isConnected());
+	CHECK(memcmp(WiFi.BSSID(), WiFi.networks[0].bssid, 6) == 0);
+}
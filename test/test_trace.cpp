@@ -0,0 +1,128 @@
+/**************************************************************
+   Trace recording and its replay into the host backend
+ **************************************************************/
+
+#include "test.h"
+#include <TraceReplay.h>
+
+//the saved credentials fail, the portal is used to enter working ones
+static void recordSession(SimpleWiFiManager& manager) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.addNetwork("neighbour", "other", 11, -75);
+	WiFi.setSavedConfig("home", "wrong");
+
+	manager.setDebugOutput(false);
+	manager.autoConnect("portal");
+	CHECK(!runFor(manager, 6000));
+	CHECK(waitForPortal(manager));
+	runFor(manager, 500);
+	get(manager, "/");
+	runFor(manager, 1500);
+
+	host::Request save;
+	save.uri = "/wifisave";
+	save.args.push_back(std::make_pair(String("s"), String("home")));
+	save.args.push_back(std::make_pair(String("p"), String("secret")));
+	request(manager, save);
+	CHECK(runFor(manager, 5000));
+}
+
+//the status changes of a trace, which the replay has to reproduce
+static std::vector<host::TraceEntry> statusChanges(const std::vector<host::TraceEntry>& entries) {
+	std::vector<host::TraceEntry> changes;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].event == host::TraceStatus || entries[i].event == host::TraceWiFiStatus || entries[i].event == host::TraceConnectFailure) {
+			changes.push_back(entries[i]);
+		}
+	}
+	return changes;
+}
+
+TEST(binaryAndTextTraceAreTheSame) {
+	SimpleWiFiManager manager;
+	recordSession(manager);
+	StringPrint text;
+	manager.dumpTrace(text);
+
+	//the portal is down after connecting, so download the trace from a new one
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+	host::Response binary = get(manager, "/trace");
+	CHECK_EQ(200, binary.code);
+
+	std::vector<host::TraceEntry> fromText, fromBinary;
+	CHECK(host::parseTrace(text.text.str(), fromText));
+	//the entries follow the status line of the response
+	const std::string& received = binary.connection->received;
+	CHECK(host::parseTrace(received.substr(received.find("\r\n") + 2), fromBinary));
+	CHECK(fromBinary.size() >= fromText.size());
+	for (size_t i = 0; i < fromText.size() && i < fromBinary.size(); i++) {
+		CHECK_EQ(fromText[i].time, fromBinary[i].time);
+		CHECK_EQ(fromText[i].event, fromBinary[i].event);
+		CHECK_EQ(fromText[i].value, fromBinary[i].value);
+		CHECK_EQ(fromText[i].detail, fromBinary[i].detail);
+	}
+}
+
+TEST(replayReproducesRecordedSession) {
+	std::string recorded;
+	{
+		SimpleWiFiManager manager;
+		recordSession(manager);
+		StringPrint text;
+		manager.dumpTrace(text);
+		recorded = text.text.str();
+	}
+
+	host::reset();
+	host::TraceReplay replay;
+	CHECK(replay.load(recorded));
+	CHECK_EQ(1, replay.firstStatus());
+	replay.begin();
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.autoConnect("portal");
+	replay.run([&manager]() { manager.HandleConnecting(); });
+	StringPrint text;
+	manager.dumpTrace(text);
+
+	std::vector<host::TraceEntry> replayed;
+	CHECK(host::parseTrace(text.text.str(), replayed));
+	std::vector<host::TraceEntry> expected = statusChanges(replay.entries());
+	std::vector<host::TraceEntry> actual = statusChanges(replayed);
+	CHECK_EQ(expected.size(), actual.size());
+	for (size_t i = 0; i < expected.size() && i < actual.size(); i++) {
+		CHECK_EQ(expected[i].event, actual[i].event);
+		CHECK_EQ(expected[i].value, actual[i].value);
+		//one tick of the replay
+		CHECK(actual[i].time - expected[i].time <= 10);
+	}
+}
+
+TEST(replayedDHCPTimeoutIsKept) {
+	WiFi.addNetwork("home", "secret", 6, -60, false);
+	WiFi.setSavedConfig("home", "secret");
+	std::string recorded;
+	{
+		SimpleWiFiManager manager;
+		manager.setDebugOutput(false);
+		manager.autoConnect("portal");
+		CHECK(!runFor(manager, 6000));
+		StringPrint text;
+		manager.dumpTrace(text);
+		recorded = text.text.str();
+	}
+
+	host::reset();
+	host::TraceReplay replay;
+	CHECK(replay.load(recorded));
+	replay.begin();
+	SimpleWiFiManager manager;
+	manager.setDebugOutput(false);
+	manager.autoConnect("portal");
+	replay.run([&manager]() { manager.HandleConnecting(); }, 10, 0);
+	StringPrint text;
+	manager.dumpTrace(text);
+	//3 is FailureDHCPTimeout
+	CHECK(text.text.str().find(" 2 3 0") != std::string::npos);
+}
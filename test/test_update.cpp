@@ -0,0 +1,116 @@
+/**************************************************************
+   Firmware upload into the file-backed OTA partition
+ **************************************************************/
+
+#include "test.h"
+#include <Updater.h>
+
+static std::string firmwareImage() {
+	std::string image;
+	for (int i = 0; i < 10000; i++) {
+		image += (char)(i * 7);
+	}
+	return image;
+}
+
+static host::Request upload(const std::string& image, const String& md5) {
+	host::Request request;
+	request.method = HTTP_POST;
+	request.uri = "/update";
+	request.args.push_back(std::make_pair(String("md5"), md5));
+	request.upload = image;
+	return request;
+}
+
+static void startPortal(SimpleWiFiManager& manager) {
+	manager.setDebugOutput(false);
+	manager.setOTAUpdateEnabled(true);
+	manager.startConfigPortal("portal");
+	CHECK(waitForPortal(manager));
+}
+
+TEST(md5MatchesReferenceDigests) {
+	CHECK(host::md5("") == "d41d8cd98f00b204e9800998ecf8427e");
+	CHECK(host::md5("abc") == "900150983cd24fb0d6963f7d28e17f72");
+	CHECK(host::md5("The quick brown fox jumps over the lazy dog") == "9e107d9d372bb6826bd81d3542a419d6");
+}
+
+TEST(uploadWithMatchingMD5IsBooted) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+	std::string image = firmwareImage();
+
+	host::Response response = request(manager, upload(image, host::md5(image)));
+	CHECK_EQ(200, response.code);
+	CHECK(Update.bootImage == image);
+	CHECK_EQ(1, ESP.restarts);
+}
+
+TEST(uploadWithWrongMD5IsRejected) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+	std::string image = firmwareImage();
+
+	host::Response response = request(manager, upload(image, host::md5("other image")));
+	CHECK_EQ(500, response.code);
+	CHECK(Update.bootImage.empty());
+	CHECK(!Update.isRunning());
+	CHECK_EQ(0, ESP.restarts);
+}
+
+TEST(uploadWithoutMD5IsRejected) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+
+	CHECK_EQ(500, request(manager, upload(firmwareImage(), "")).code);
+	CHECK(!Update.isRunning());
+	CHECK_EQ(0, ESP.restarts);
+}
+
+TEST(failedWriteReleasesUpdater) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+	std::string image = firmwareImage();
+
+	Update.failWriteAfter = 3000;
+	CHECK_EQ(500, request(manager, upload(image, host::md5(image))).code);
+	CHECK(!Update.isRunning());
+
+	//the next upload must not be refused
+	Update.failWriteAfter = SIZE_MAX;
+	CHECK_EQ(200, request(manager, upload(image, host::md5(image))).code);
+	CHECK(Update.bootImage == image);
+}
+
+TEST(abortedUploadReleasesUpdater) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+	std::string image = firmwareImage();
+
+	host::Request aborted = upload(image, host::md5(image));
+	aborted.abortUploadAfter = 4096;
+	request(manager, aborted);
+	CHECK(!Update.isRunning());
+	CHECK(Update.bootImage.empty());
+
+	CHECK_EQ(200, request(manager, upload(image, host::md5(image))).code);
+}
+
+TEST(postWithoutFileIsRejected) {
+	SimpleWiFiManager manager;
+	startPortal(manager);
+
+	host::Request request = upload("", host::md5(""));
+	request.filePart = false;
+	CHECK_EQ(400, ::request(manager, request).code);
+	CHECK(Update.bootImage.empty());
+	CHECK_EQ(0, ESP.restarts);
+
+	//an upload that was cut off does not count as started for the next POST
+	std::string image = firmwareImage();
+	host::Request aborted = upload(image, host::md5(image));
+	aborted.abortUploadAfter = 4096;
+	::request(manager, aborted);
+	CHECK_EQ(400, ::request(manager, request).code);
+	CHECK_EQ(0, ESP.restarts);
+}
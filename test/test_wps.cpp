@@ -0,0 +1,58 @@
+/**************************************************************
+   WPS fallback, when the saved credentials fail
+ **************************************************************/
+
+#include "test.h"
+
+//the saved network is gone, so autoConnect falls back to WPS
+static void startWithStaleCredentials(SimpleWiFiManager& manager) {
+	WiFi.setSavedConfig("old", "old-secret");
+	manager.setDebugOutput(false);
+	manager.setTryWPS(true, 30);
+	manager.autoConnect("portal");
+	//the saved credentials time out
+	CHECK(!runFor(manager, 6000));
+	CHECK(manager.IsConnecting());
+	CHECK(!(WiFi.getMode() & WIFI_AP));
+}
+
+TEST(wpsConnectsWithReceivedCredentials) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+	WiFi.wpsButtonPressed = true;
+	WiFi.wpsSSID = "home";
+	WiFi.wpsPsk = "secret";
+
+	SimpleWiFiManager manager;
+	startWithStaleCredentials(manager);
+	CHECK(runFor(manager, 10000));
+	CHECK(WiFi.isConnected());
+	CHECK(!manager.IsConnecting());
+	CHECK(WiFi.savedConfig().ssid == "home");
+	CHECK(WiFi.savedConfig().psk == "secret");
+}
+
+TEST(wpsTimeoutStartsPortalAndKeepsSavedCredentials) {
+	WiFi.addNetwork("home", "secret", 6, -60);
+
+	SimpleWiFiManager manager;
+	startWithStaleCredentials(manager);
+	//nobody pressed the button
+	CHECK(!runFor(manager, 25000));
+	CHECK(!(WiFi.getMode() & WIFI_AP));
+	CHECK(!runFor(manager, 6000));
+	CHECK(waitForPortal(manager));
+	CHECK(manager.IsConnecting());
+	CHECK(WiFi.savedConfig().ssid == "old");
+	CHECK(WiFi.savedConfig().psk == "old-secret");
+}
+
+TEST(wpsFailureStartsPortal) {
+	WiFi.wpsButtonPressed = true;
+	WiFi.wpsResult = WPS_CB_ST_FAILED;
+
+	SimpleWiFiManager manager;
+	startWithStaleCredentials(manager);
+	CHECK(!runFor(manager, 5000));
+	CHECK(waitForPortal(manager));
+	CHECK(WiFi.savedConfig().ssid == "old");
+}